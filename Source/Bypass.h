@@ -0,0 +1,93 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+
+/*
+* Bypass with tails.
+* Bypassing fades the planet bus's input out over FadeLengthMs, while the dry signal
+* takes over the rest of the output at unity gain. The chain keeps running on silence
+* (Tail) until the delays culled every planet, i.e. their rings rang out. From then on
+* (Sleep) the chain is not processed at all and the input only passes the dry signal's
+* latency compensation. Leaving the bypass, from any state, fades the input back in.
+*/
+
+namespace bypass
+{
+	enum class State { Active, FadingOut, Tail, Sleep };
+
+	/********** struct Processor **********/
+	template<typename Float>
+	struct Processor
+	{
+		static constexpr Float FadeLengthMs = static_cast<Float>(20);
+
+		Processor() :
+			fadeBuf(),
+			fade(static_cast<Float>(1)),
+			fadeInc(static_cast<Float>(0)),
+			state(State::Active)
+		{}
+
+		void prepare(Float sampleRate, int blockSize)
+		{
+			fadeBuf.assign(blockSize, static_cast<Float>(0));
+			fadeInc = static_cast<Float>(1000) / (FadeLengthMs * sampleRate);
+			fade = static_cast<Float>(1);
+			state = State::Active;
+		}
+
+		/*
+		* call once per block before processing it. silent: the delays culled every planet.
+		* returns the planets' share of the block's output, or nullptr if it's 1 throughout
+		*/
+		const Float* operator()(bool bypassed, bool silent, int numSamples) noexcept
+		{
+			if (!bypassed)
+			{
+				if (state == State::Active && fade == static_cast<Float>(1))
+					return nullptr;
+				state = State::Active;
+				return makeRamp(fadeInc, numSamples);
+			}
+
+			switch (state)
+			{
+			case State::Active:
+				state = State::FadingOut;
+				[[fallthrough]];
+			case State::FadingOut:
+			{
+				const auto ramp = makeRamp(-fadeInc, numSamples);
+				if (fade == static_cast<Float>(0))
+					state = State::Tail;
+				return ramp;
+			}
+			case State::Tail:
+				if (silent)
+					state = State::Sleep;
+				[[fallthrough]];
+			default:
+				std::fill(fadeBuf.begin(), fadeBuf.begin() + numSamples, static_cast<Float>(0));
+				return fadeBuf.data();
+			}
+		}
+
+		// the chain can skip the block
+		bool isAsleep() const noexcept { return state == State::Sleep; }
+		State getState() const noexcept { return state; }
+	private:
+		std::vector<Float> fadeBuf;
+		Float fade, fadeInc;
+		State state;
+
+		const Float* makeRamp(Float inc, int numSamples) noexcept
+		{
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				fade = std::min(std::max(fade + inc, static_cast<Float>(0)), static_cast<Float>(1));
+				fadeBuf[s] = fade;
+			}
+			return fadeBuf.data();
+		}
+	};
+}
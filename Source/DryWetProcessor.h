@@ -5,41 +5,79 @@
 
 namespace drywet
 {
+	template<typename Float>
 	struct Processor
 	{
-		using Smooth = orbit::Smooth<float>;
-		using DryBuf = std::array<std::vector<float>, 2>;
-		using SqrtBuf = std::array<std::vector<float>, 2>;
-		using ParamBuf = std::vector<float>;
+		using Smooth = orbit::Smooth<Float>;
+		using DryBuf = std::array<std::vector<Float>, orbit::MaxChannels>;
+		using LatencyBuf = std::array<std::vector<Float>, orbit::MaxChannels>;
+		using SqrtBuf = std::array<std::vector<Float>, 2>;
+		using ParamBuf = std::vector<Float>;
+		static constexpr bool IsFloat = std::is_same<Float, float>::value;
 
 		Processor() :
 			mixSmooth(), gainSmooth(),
 			mixBuf(), gainBuf(),
 			dryBuf(),
 			sqrtBuf(),
-			gain(0.f), gainVal(1.f)
+			latencyBuf(),
+			gain(0.f), gainVal(static_cast<Float>(1)),
+			steadyMix(static_cast<Float>(-1)), steadyGain(static_cast<Float>(-1)),
+			latency(0), latencyIdx(0)
 		{
 		}
-		void prepare(float sampleRate, int blockSize)
+		// latency: the wet signal's latency in samples. the dry signal is delayed to match it
+		void prepare(Float sampleRate, int blockSize, int numChannels, int _latency = 0)
 		{
-			orbit::prepareParam(mixSmooth, mixBuf, 20.f, sampleRate, blockSize);
-			orbit::prepareParam(gainSmooth, gainBuf, 20.f, sampleRate, blockSize);
-			for (auto& d : dryBuf)
-				d.resize(blockSize, 0.f);
+			latency = _latency;
+			latencyIdx = 0;
+			for (auto ch = 0; ch < orbit::MaxChannels; ++ch)
+			{
+				const auto used = ch < numChannels;
+				latencyBuf[ch].assign(used ? latency : 0, static_cast<Float>(0));
+				dryBuf[ch].assign(used ? blockSize : 0, static_cast<Float>(0));
+			}
+			orbit::prepareParam(mixSmooth, mixBuf, static_cast<Float>(20), sampleRate, blockSize);
+			orbit::prepareParam(gainSmooth, gainBuf, static_cast<Float>(20), sampleRate, blockSize);
 			for (auto& s : sqrtBuf)
 				s.resize(blockSize);
+			steadyMix = steadyGain = static_cast<Float>(-1);
 		}
-		void saveDry(const float** samples, float mixVal, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
+		// fade: as in processWet. the dry signal isn't saved while mix settled fully wet and nothing fades
+		void saveDry(const Float** samples, Float mixVal, int numChannelsIn, int numChannelsOut, int numSamples,
+			const Float* fade = nullptr) noexcept
 		{
-			{ // SMOOTHEN PARAMETER VALUE pVAL
-				for (auto s = 0; s < numSamples; ++s)
-					mixBuf[s] = mixSmooth(mixVal);
+			// once mix settled, its buffers hold it over the whole block size and are kept as they are
+			if (mixVal != steadyMix)
+			{
+				const auto settled = mixSmooth.isConverged(mixVal);
+				const auto n = settled ? static_cast<int>(mixBuf.size()) : numSamples;
+				{ // SMOOTHEN PARAMETER VALUE pVAL
+					mixSmooth(mixBuf.data(), mixVal, n);
+				}
+				{ // MAKING EQUAL LOUDNESS CURVES
+					if constexpr (IsFloat)
+						simd::get().equalPower(mixBuf.data(), sqrtBuf[0].data(), sqrtBuf[1].data(), n);
+					else
+						for (auto s = 0; s < n; ++s)
+						{
+							sqrtBuf[0][s] = std::sqrt(static_cast<Float>(1) - mixBuf[s]);
+							sqrtBuf[1][s] = std::sqrt(mixBuf[s]);
+						}
+				}
+				steadyMix = settled ? mixVal : static_cast<Float>(-1);
 			}
-			{ // MAKING EQUAL LOUDNESS CURVES
-				for (auto s = 0; s < numSamples; ++s)
-					sqrtBuf[0][s] = std::sqrt(1.f - mixBuf[s]);
-				for (auto s = 0; s < numSamples; ++s)
-					sqrtBuf[1][s] = std::sqrt(mixBuf[s]);
+			if (steadyMix == static_cast<Float>(1) && fade == nullptr)
+			{
+				// the latency ring still has to hold the latest input once mix moves again
+				if (latency != 0)
+				{
+					auto idx = latencyIdx;
+					for (auto ch = 0; ch < numChannelsIn; ++ch)
+						idx = feedLatency(samples[ch], ch, numSamples);
+					latencyIdx = idx;
+				}
+				return;
 			}
 			{ // SAVE DRY BUFFER
 				for (auto ch = 0; ch < numChannelsIn; ++ch)
@@ -50,39 +88,160 @@ namespace drywet
 					juce::FloatVectorOperations::copy(dry, smpls, numSamples);
 				}
 			}
+			if (latency != 0)
+			{ // LATENCY COMPENSATION
+				auto idx = latencyIdx;
+				for (auto ch = 0; ch < numChannelsIn; ++ch)
+					idx = compensateLatency(dryBuf[ch].data(), ch, numSamples);
+				latencyIdx = idx;
+			}
 		}
-		void processWet(float** samples, float _gain, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
+		// while bypassed and asleep: only delays the input like the dry signal, so it continues seamlessly
+		void bypass(Float** samples, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
 		{
-			if (gain != _gain)
+			if (latency != 0)
 			{
-				gain = _gain;
-				gainVal = juce::Decibels::decibelsToGain(gain);
+				auto idx = latencyIdx;
+				for (auto ch = 0; ch < numChannelsIn; ++ch)
+					idx = compensateLatency(samples[ch], ch, numSamples);
+				latencyIdx = idx;
 			}
+			for (auto ch = numChannelsIn; ch < numChannelsOut; ++ch)
+				juce::FloatVectorOperations::copy(samples[ch], samples[ch % numChannelsIn], numSamples);
+		}
+		// fade: the planets' share of the output while the bypass fades, nullptr = 1. the dry signal makes up the rest
+		void processWet(Float** samples, float _gain, int numChannelsIn, int numChannelsOut, int numSamples,
+			const Float* fade = nullptr) noexcept
+		{
+			if (gain != _gain)
 			{
-				for (auto s = 0; s < numSamples; ++s)
-					gainBuf[s] = gainSmooth(gainVal);
+				gain = _gain;
+				gainVal = juce::Decibels::decibelsToGain(static_cast<Float>(gain));
 			}
+			if (gainVal != steadyGain)
 			{
-				auto smpls = samples[0];
-				const auto dry = dryBuf[0].data();
-
-				for (auto s = 0; s < numSamples; ++s)
-					smpls[s] = (dry[s] * sqrtBuf[0][s] + smpls[s] * sqrtBuf[1][s]) * gainBuf[s];
+				const auto settled = gainSmooth.isConverged(gainVal);
+				gainSmooth(gainBuf.data(), gainVal, settled ? static_cast<int>(gainBuf.size()) : numSamples);
+				steadyGain = settled ? gainVal : static_cast<Float>(-1);
 			}
-			if (numChannelsOut == 2)
+			if (fade == nullptr && steadyMix >= static_cast<Float>(0))
+				return processSteady(samples, numChannelsIn, numChannelsOut, numSamples);
+			for (auto ch = 0; ch < numChannelsOut; ++ch)
 			{
-				auto smpls = samples[1];
-				const auto dry = dryBuf[1 % numChannelsIn].data();
+				auto smpls = samples[ch];
+				const auto dry = dryBuf[ch % numChannelsIn].data();
 
-				for (auto s = 0; s < numSamples; ++s)
-					smpls[s] = (dry[s] * sqrtBuf[0][s] + smpls[s] * sqrtBuf[1][s]) * gainBuf[s];
+				mixDryWet(smpls, dry, numSamples);
+				if (fade != nullptr)
+					mixBypass(smpls, dry, fade, numSamples);
 			}
 		}
+		// while the planets sleep on a silent input: the dry signal and its latency go on as with a silent wet one
+		void processSilence(Float** samples, Float mixVal, float _gain, int numChannelsIn, int numChannelsOut,
+			int numSamples) noexcept
+		{
+			saveDry(const_cast<const Float**>(samples), mixVal, numChannelsIn, numChannelsOut, numSamples);
+			for (auto ch = 0; ch < numChannelsOut; ++ch)
+				juce::FloatVectorOperations::clear(samples[ch], numSamples);
+			processWet(samples, _gain, numChannelsIn, numChannelsOut, numSamples);
+		}
 	protected:
 		Smooth mixSmooth, gainSmooth;
 		ParamBuf mixBuf, gainBuf;
 		DryBuf dryBuf;
 		SqrtBuf sqrtBuf;
-		float gain, gainVal;
+		LatencyBuf latencyBuf;
+		float gain;
+		// the values mixBuf and gainBuf hold throughout, -1 while they are smoothed
+		Float gainVal, steadyMix, steadyGain;
+		int latency, latencyIdx;
+
+		// settled mix: fully wet and fully dry skip the blend, unity gain skips the gain
+		void processSteady(Float** samples, int numChannelsIn, int numChannelsOut, int numSamples) noexcept
+		{
+			const auto g = gainBuf.data();
+			for (auto ch = 0; ch < numChannelsOut; ++ch)
+			{
+				auto smpls = samples[ch];
+				const auto dry = dryBuf[ch % numChannelsIn].data();
+
+				if (steadyMix == static_cast<Float>(1))
+				{
+					if (steadyGain < static_cast<Float>(0))
+						juce::FloatVectorOperations::multiply(smpls, g, numSamples);
+					else if (steadyGain != static_cast<Float>(1))
+						juce::FloatVectorOperations::multiply(smpls, steadyGain, numSamples);
+				}
+				else if (steadyMix == static_cast<Float>(0))
+				{
+					if (steadyGain < static_cast<Float>(0))
+						juce::FloatVectorOperations::multiply(smpls, dry, g, numSamples);
+					else if (steadyGain != static_cast<Float>(1))
+						juce::FloatVectorOperations::multiply(smpls, dry, steadyGain, numSamples);
+					else
+						juce::FloatVectorOperations::copy(smpls, dry, numSamples);
+				}
+				else if (steadyGain < static_cast<Float>(0))
+					mixDryWet(smpls, dry, numSamples);
+				else
+				{
+					const auto dryGain = sqrtBuf[0][0];
+					const auto wetGain = sqrtBuf[1][0];
+					if constexpr (IsFloat)
+						simd::get().mixDryWetSteady(smpls, dry, dryGain, wetGain, steadyGain, numSamples);
+					else
+						for (auto s = 0; s < numSamples; ++s)
+							smpls[s] = (dry[s] * dryGain + smpls[s] * wetGain) * steadyGain;
+				}
+			}
+		}
+
+		void mixDryWet(Float* smpls, const Float* dry, int numSamples) noexcept
+		{
+			const auto dryGain = sqrtBuf[0].data();
+			const auto wetGain = sqrtBuf[1].data();
+			if constexpr (IsFloat)
+				simd::get().mixDryWet(smpls, dry, dryGain, wetGain, gainBuf.data(), numSamples);
+			else
+				for (auto s = 0; s < numSamples; ++s)
+					smpls[s] = (dry[s] * dryGain[s] + smpls[s] * wetGain[s]) * gainBuf[s];
+		}
+
+		// moves the dry part of the mix from dryGain * gain towards unity as fade goes to 0
+		void mixBypass(Float* smpls, const Float* dry, const Float* fade, int numSamples) noexcept
+		{
+			const auto dryGain = sqrtBuf[0].data();
+			for (auto s = 0; s < numSamples; ++s)
+				smpls[s] += (static_cast<Float>(1) - fade[s]) * dry[s] * (static_cast<Float>(1) - dryGain[s] * gainBuf[s]);
+		}
+
+		// like compensateLatency without reading the delayed samples. only the last latency samples matter
+		int feedLatency(const Float* smpls, int ch, int numSamples) noexcept
+		{
+			auto ring = latencyBuf[ch].data();
+			const auto start = std::max(0, numSamples - latency);
+			auto idx = (latencyIdx + start) % latency;
+			for (auto s = start; s < numSamples; ++s)
+			{
+				ring[idx] = smpls[s];
+				idx = idx + 1 == latency ? 0 : idx + 1;
+			}
+			return idx;
+		}
+
+		// delays one channel by latency samples in-place. returns the ring index after it
+		int compensateLatency(Float* smpls, int ch, int numSamples) noexcept
+		{
+			auto ring = latencyBuf[ch].data();
+			auto idx = latencyIdx;
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				const auto x = smpls[s];
+				smpls[s] = ring[idx];
+				ring[idx] = x;
+				idx = idx + 1 == latency ? 0 : idx + 1;
+			}
+			return idx;
+		}
 	};
 }
\ No newline at end of file
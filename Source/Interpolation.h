@@ -0,0 +1,230 @@
+#pragma once
+#include <cmath>
+#include <array>
+#include <algorithm>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include "Constants.h"
+
+/*
+* Fractional-delay read policies for orbit::Delay.
+* A policy reads NumPoints frames, starting Before frames ahead of the
+* integer read position i, and turns the fractional part t of the read
+* position into one weight per point, 0 <= t <= 1 (MultiTap passes 1 for
+* whole-number delays). The weights are computed for a whole lane of taps
+* at once and then applied to every channel.
+* Recursive policies also return a feedback coefficient per lane.
+*/
+
+namespace orbit
+{
+	namespace interpolation
+	{
+		enum class Type { Linear, Hermite, Lagrange4, Lagrange6, Allpass, Sinc, NumTypes };
+		static constexpr int NumTypes = static_cast<int>(Type::NumTypes);
+
+		inline juce::String toString(Type type)
+		{
+			switch (type)
+			{
+			case Type::Linear: return "linear";
+			case Type::Hermite: return "hermite";
+			case Type::Lagrange4: return "lagrange4";
+			case Type::Lagrange6: return "lagrange6";
+			case Type::Allpass: return "allpass";
+			case Type::Sinc: return "sinc";
+			default: return "";
+			}
+		}
+
+		/********** struct Linear **********/
+		template<typename Float>
+		struct Linear
+		{
+			static constexpr int NumPoints = 2;
+			static constexpr int Before = 0;
+			static constexpr bool Recursive = false;
+
+			template<int NumLanes, typename Lane, typename Weights>
+			static void weights(const Lane& t, Weights& w, Lane&) noexcept
+			{
+				for (auto l = 0; l < NumLanes; ++l)
+				{
+					w[0][l] = static_cast<Float>(1) - t[l];
+					w[1][l] = t[l];
+				}
+			}
+		};
+
+		/********** struct Hermite **********/
+		template<typename Float>
+		struct Hermite
+		{
+			static constexpr int NumPoints = 4;
+			static constexpr int Before = 1;
+			static constexpr bool Recursive = false;
+
+			template<int NumLanes, typename Lane, typename Weights>
+			static void weights(const Lane& t, Weights& w, Lane&) noexcept
+			{
+				for (auto l = 0; l < NumLanes; ++l)
+				{
+					const auto t1 = t[l];
+					const auto t2 = t1 * t1;
+					const auto t3 = t2 * t1;
+					w[0][l] = static_cast<Float>(-.5) * t1 + t2 - static_cast<Float>(.5) * t3;
+					w[1][l] = static_cast<Float>(1) - static_cast<Float>(2.5) * t2 + static_cast<Float>(1.5) * t3;
+					w[2][l] = static_cast<Float>(.5) * t1 + static_cast<Float>(2) * t2 - static_cast<Float>(1.5) * t3;
+					w[3][l] = static_cast<Float>(-.5) * t2 + static_cast<Float>(.5) * t3;
+				}
+			}
+		};
+
+		/********** struct Lagrange **********/
+		template<typename Float, int Order>
+		struct Lagrange
+		{
+			static constexpr int NumPoints = Order + 1;
+			static constexpr int Before = (NumPoints - 1) / 2;
+			static constexpr bool Recursive = false;
+
+			template<int NumLanes, typename Lane, typename Weights>
+			static void weights(const Lane& t, Weights& w, Lane&) noexcept
+			{
+				for (auto k = 0; k < NumPoints; ++k)
+				{
+					auto denom = static_cast<Float>(1);
+					for (auto j = 0; j < NumPoints; ++j)
+						if (j != k)
+							denom *= static_cast<Float>(k - j);
+					const auto denomInv = static_cast<Float>(1) / denom;
+
+					for (auto l = 0; l < NumLanes; ++l)
+					{
+						const auto x = t[l] + static_cast<Float>(Before);
+						auto num = denomInv;
+						for (auto j = 0; j < NumPoints; ++j)
+							if (j != k)
+								num *= x - static_cast<Float>(j);
+						w[k][l] = num;
+					}
+				}
+			}
+		};
+
+		/*
+		* First-order allpass (Thiran). The fractional delay is kept within [.5, 1.5)
+		* by choosing the newer of the two integer positions.
+		* y = w . x - feedback * y[n - 1]
+		*/
+		template<typename Float>
+		struct Allpass
+		{
+			static constexpr int NumPoints = 3;
+			static constexpr int Before = 0;
+			static constexpr bool Recursive = true;
+
+			template<int NumLanes, typename Lane, typename Weights>
+			static void weights(const Lane& t, Weights& w, Lane& feedback) noexcept
+			{
+				for (auto l = 0; l < NumLanes; ++l)
+				{
+					const auto near = t[l] <= static_cast<Float>(.5);
+					const auto delta = (near ? static_cast<Float>(1) : static_cast<Float>(2)) - t[l];
+					const auto a = (static_cast<Float>(1) - delta) / (static_cast<Float>(1) + delta);
+					w[0][l] = near ? static_cast<Float>(1) : static_cast<Float>(0);
+					w[1][l] = near ? a : static_cast<Float>(1);
+					w[2][l] = near ? static_cast<Float>(0) : a;
+					feedback[l] = a;
+				}
+			}
+		};
+
+		/*
+		* Windowed-sinc (Blackman-Harris) lowpass at .9 * nyquist, tabulated in
+		* NumPhases fractional positions and linearly interpolated between them.
+		* Each phase is normalised to unity gain at DC.
+		*/
+		template<typename Float, int NumTaps>
+		struct SincTable
+		{
+			using numConst = constants::NumericConstants<Float>;
+			static constexpr int NumPhases = 512;
+			static constexpr Float Cutoff = static_cast<Float>(.9);
+
+			static const SincTable& getInstance()
+			{
+				static SincTable instance{};
+				return instance;
+			}
+
+			const Float* getPhase(int ph) const noexcept { return &table[ph * NumTaps]; }
+
+			SincTable& operator=(const SincTable& other) = delete;
+			SincTable(const SincTable& other) = delete;
+		private:
+			std::vector<Float> table;
+
+			SincTable() :
+				table((NumPhases + 1) * NumTaps)
+			{
+				const auto centre = static_cast<double>(NumTaps / 2 - 1);
+				for (auto ph = 0; ph <= NumPhases; ++ph)
+				{
+					const auto t = static_cast<double>(ph) / static_cast<double>(NumPhases);
+					auto sum = 0.;
+					std::array<double, NumTaps> w;
+					for (auto k = 0; k < NumTaps; ++k)
+					{
+						const auto x = static_cast<double>(k) - centre - t;
+						const auto px = 3.14159265359 * x * Cutoff;
+						const auto sinc = x == 0. ? 1. : std::sin(px) / px;
+						const auto n = (x + static_cast<double>(NumTaps) * .5) / static_cast<double>(NumTaps);
+						const auto tau = 6.28318530718 * n;
+						const auto win = .35875 - .48829 * std::cos(tau) + .14128 * std::cos(2. * tau) - .01168 * std::cos(3. * tau);
+						w[k] = sinc * win;
+						sum += w[k];
+					}
+					for (auto k = 0; k < NumTaps; ++k)
+						table[ph * NumTaps + k] = static_cast<Float>(w[k] / sum);
+				}
+			}
+		};
+
+		template<typename Float, int NumTaps>
+		struct Sinc
+		{
+			static constexpr int NumPoints = NumTaps;
+			static constexpr int Before = NumTaps / 2 - 1;
+			static constexpr bool Recursive = false;
+
+			using Table = SincTable<Float, NumTaps>;
+
+			template<int NumLanes, typename Lane, typename Weights>
+			static void weights(const Lane& t, Weights& w, Lane&) noexcept
+			{
+				const auto& table = Table::getInstance();
+				for (auto l = 0; l < NumLanes; ++l)
+				{
+					// t is in (0, 1], t == 1 (whole-number delays) is the last row with frac 1
+					const auto x = t[l] * static_cast<Float>(Table::NumPhases);
+					const auto ph = std::min(static_cast<int>(x), Table::NumPhases - 1);
+					const auto frac = x - static_cast<Float>(ph);
+					const auto row0 = table.getPhase(ph);
+					const auto row1 = table.getPhase(ph + 1);
+					for (auto k = 0; k < NumPoints; ++k)
+						w[k][l] = row0[k] + frac * (row1[k] - row0[k]);
+				}
+			}
+		};
+
+		template<typename Float> using Lagrange4 = Lagrange<Float, 3>;
+		template<typename Float> using Lagrange6 = Lagrange<Float, 5>;
+		template<typename Float> using Sinc16 = Sinc<Float, 16>;
+
+		// the largest read footprint of all policies. sizes the rings' guard frames
+		static constexpr int MaxBefore = 7;
+		static constexpr int MaxAfter = 8;
+		static constexpr int MaxPoints = MaxBefore + MaxAfter + 1;
+	}
+}
@@ -2,10 +2,16 @@
 #include <cmath>
 #include <limits>
 #include <array>
+#include <atomic>
+#include <memory>
 #include <juce_core/juce_core.h>
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_data_structures/juce_data_structures.h>
 #include "Constants.h"
+#include "Interpolation.h"
+#include "RingStorage.h"
+#include "Simd.h"
+#include "WorkerPool.h"
 
 namespace orbit
 {
@@ -26,6 +32,10 @@ namespace orbit
 	struct Smooth
 	{
 		using numConst = constants::NumericConstants<Float>;
+		using DecayBuf = std::vector<Float>;
+
+		// distance to the target (relative to its magnitude) below which the smoother counts as converged
+		static constexpr Float ConvergenceEps = static_cast<Float>(1e-6);
 
 		void makeFromDecayInSamples(Float d) noexcept
 		{
@@ -55,20 +65,29 @@ namespace orbit
 		}
 
 		Smooth(const bool _snap = false, const Float _startVal = static_cast<Float>(0)) :
+			decayBuf(),
 			a0(static_cast<Float>(1)),
 			b1(static_cast<Float>(0)),
 			y1(_startVal),
 			eps(static_cast<Float>(0)),
-			snap(_snap),
-			startVal(_startVal)
+			startVal(_startVal),
+			snap(_snap)
 		{}
 
+		/* allocates the table of decay powers used for the closed-form ramps */
+		void prepare(int blockSize)
+		{
+			decayBuf.resize(blockSize);
+			updateDecayBuf();
+		}
+
 		void reset()
 		{
 			a0 = static_cast<Float>(1);
 			b1 = static_cast<Float>(0);
 			y1 = startVal;
 			eps = static_cast<Float>(0);
+			updateDecayBuf();
 		}
 
 		void setX(Float x) noexcept
@@ -76,20 +95,46 @@ namespace orbit
 			a0 = static_cast<Float>(1) - x;
 			b1 = x;
 			eps = a0 * static_cast<Float>(1.5);
+			updateDecayBuf();
 		}
 
-		void operator()(Float* buffer, Float val, int numSamples) noexcept
+		/*
+		* smoothens towards a constant target. once converged this is only a fill.
+		* returns true if it was, i.e. the buffer holds val throughout
+		*/
+		bool operator()(Float* buffer, Float val, int numSamples) noexcept
 		{
-			if (buffer[0] == val)
-				return juce::FloatVectorOperations::fill(buffer, val, numSamples);
-			for (auto s = 0; s < numSamples; ++s)
-				buffer[s] = processSample(val);
+			if (isConverged(val))
+			{
+				y1 = val;
+				if constexpr (std::is_same<Float, float>::value)
+					simd::get().fill(buffer, val, numSamples);
+				else
+					juce::FloatVectorOperations::fill(buffer, val, numSamples);
+				return true;
+			}
+			ramp(buffer, val, numSamples);
+			return false;
 		}
 
-		void operator()(Float* buffer, int numSamples) noexcept
-		{
-			for (auto s = 0; s < numSamples; ++s)
-				buffer[s] = processSample(buffer[s]);
+		/*
+		* smoothens a buffer of targets in-place. spans of equal targets are ramped in closed form.
+		* returns true if the buffer holds one value throughout
+		*/
+		bool operator()(Float* buffer, int numSamples) noexcept
+		{
+			auto constant = true;
+			auto s = 0;
+			while (s < numSamples)
+			{
+				const auto val = buffer[s];
+				auto e = s + 1;
+				while (e < numSamples && buffer[e] == val)
+					++e;
+				constant &= operator()(&buffer[s], val, e - s) && s == 0 && e == numSamples;
+				s = e;
+			}
+			return constant;
 		}
 
 		Float operator()(Float sample) noexcept
@@ -97,7 +142,19 @@ namespace orbit
 			return processSample(sample);
 		}
 
+		/* jumps to val without smoothing */
+		void setValue(Float val) noexcept { y1 = val; }
+
+		Float getValue() const noexcept { return y1; }
+
+		bool isConverged(Float val) const noexcept
+		{
+			const auto dist = std::abs(y1 - val);
+			return dist <= ConvergenceEps * (static_cast<Float>(1) + std::abs(val));
+		}
+
 	private:
+		DecayBuf decayBuf;
 		Float a0, b1, y1, eps, startVal;
 		const bool snap;
 
@@ -109,12 +166,48 @@ namespace orbit
 				y1 = x0 * a0 + y1 * b1;
 			return y1;
 		}
+
+		/* y[n] = val + (y[-1] - val) * b1^(n+1) */
+		void ramp(Float* buffer, Float val, int numSamples) noexcept
+		{
+			const auto size = static_cast<int>(decayBuf.size());
+			if (snap || numSamples > size)
+			{
+				for (auto s = 0; s < numSamples; ++s)
+					buffer[s] = processSample(val);
+				return;
+			}
+
+			const auto decay = decayBuf.data();
+			const auto dist = y1 - val;
+			if constexpr (std::is_same<Float, float>::value)
+				simd::get().ramp(buffer, val, dist, decay, numSamples);
+			else
+				for (auto s = 0; s < numSamples; ++s)
+					buffer[s] = val + dist * decay[s];
+			// a slow ramp can stall in float short of ConvergenceEps, where a block no longer moves it
+			const auto stalled = buffer[numSamples - 1] == y1;
+			y1 = buffer[numSamples - 1];
+			if (stalled || isConverged(val))
+				y1 = val;
+		}
+
+		void updateDecayBuf() noexcept
+		{
+			auto x = b1;
+			for (auto& d : decayBuf)
+			{
+				d = x;
+				x *= b1;
+			}
+		}
 	};
 
 	template<typename Float>
 	inline void prepareParam(Smooth<Float>& smooth, std::vector<Float>& buf, Float smoothLen,
 		Float sampleRate, int blockSize)
 	{
+		smooth.prepare(blockSize);
 		smooth.makeFromDecayInMs(smoothLen, sampleRate);
 		buf.resize(blockSize, static_cast<Float>(0));
 	}
@@ -327,17 +420,26 @@ namespace orbit
 			Fs(static_cast<Number>(48000)),
 			blockSize(64),
 			idx(0), // or -1?
+			baseOrder(_order),
 			order(1 << _order)
 		{
 		}
 
-		void prepare(Number sampleRate, int _blockSize) noexcept
+		// oversamplingOrder: log2 of the factor sampleRate is oversampled by. keeps Fs at the base rate's
+		void prepare(Number sampleRate, int _blockSize, int oversamplingOrder = 0) noexcept
 		{
+			order = 1 << (baseOrder + oversamplingOrder);
+			idx %= order;
 			const auto oInv = static_cast<Number>(1) / static_cast<Number>(order);
 			Fs = sampleRate * oInv;
 			blockSize = _blockSize * oInv;
 		}
 
+		// the samples after the current one that pass without a step
+		int getNumSkippable() const noexcept { return order - idx - 1; }
+
+		void skip(int numSamples) noexcept { idx += numSamples; }
+
 		bool doProcess() noexcept
 		{
 			++idx;
@@ -353,7 +455,8 @@ namespace orbit
 	private:
 		int blockSize;
 		int idx;
-		const int order;
+		const int baseOrder;
+		int order;
 	};
 
 	template<typename Float>
@@ -488,21 +591,64 @@ namespace orbit
 			prepareParam(magSmooth, magBuf, static_cast<Float>(20), sampleRate, blockSize);
 		}
 		
-		void update(const Plnt& planet, int s) noexcept
-		{
-			magBuf[s] = std::tanh(planet.mag * static_cast<Float>(8000));
-			phaseBuf[s] = planet.angle * planet.angle + planet.pos.x * planet.pos.y * numConst::Tau;
+		// the planet's state holds for the samples [s, s + numSamples). it may run at another precision
+		template<typename PlanetFloat>
+		void update(const Planet<PlanetFloat>& planet, int s, int numSamples) noexcept
+		{
+			using planetConst = constants::NumericConstants<PlanetFloat>;
+			const auto mag = static_cast<Float>(std::tanh(planet.mag * static_cast<PlanetFloat>(8000)));
+			const auto phase = static_cast<Float>(planet.angle * planet.angle + planet.pos.x * planet.pos.y * planetConst::Tau);
+			if constexpr (std::is_same<Float, float>::value)
+			{
+				const auto& kernels = simd::get();
+				kernels.fill(&magBuf[s], mag, numSamples);
+				kernels.fill(&phaseBuf[s], phase, numSamples);
+			}
+			else
+			{
+				std::fill(&magBuf[s], &magBuf[s] + numSamples, mag);
+				std::fill(&phaseBuf[s], &phaseBuf[s] + numSamples, phase);
+			}
 		}
 		
-		void makeSmooth(const float* depth, float ringBufferSize, int numSamples) noexcept
-		{
-			for (auto s = 0; s < numSamples; ++s)
+		/*
+		* span: the longest delay of each sample in frames, or of all of them with ConstSpan.
+		* a phase that settled on one value is turned into a delay once for the whole block,
+		* unless SettledPhase is false, which forces the general path, e.g. to compare against
+		*/
+		template<bool ConstSpan, bool SettledPhase = true>
+		void makeSmooth(const Float* span, int numSamples) noexcept
+		{
+			static constexpr auto Half = static_cast<Float>(.5);
+			const auto constPhase = phaseSmooth(phaseBuf.data(), numSamples);
+			magSmooth(magBuf.data(), numSamples);
+			if (SettledPhase && constPhase)
+			{
+				const auto x = Half * std::cos(phaseBuf[0]) + Half;
+				if constexpr (ConstSpan)
+					std::fill(phaseBuf.begin(), phaseBuf.begin() + numSamples, span[0] * x);
+				else
+					for (auto s = 0; s < numSamples; ++s)
+						phaseBuf[s] = span[s] * x;
+			}
+			else if constexpr (ConstSpan)
 			{
-				phaseBuf[s] = ringBufferSize * depth[s] * (.5f * std::cos(phaseSmooth(phaseBuf[s])) + .5f);
-				magBuf[s] = magSmooth(magBuf[s]);
+				const auto spanVal = span[0];
+				for (auto s = 0; s < numSamples; ++s)
+					phaseBuf[s] = spanVal * (Half * std::cos(phaseBuf[s]) + Half);
 			}
+			else
+				for (auto s = 0; s < numSamples; ++s)
+					phaseBuf[s] = span[s] * (Half * std::cos(phaseBuf[s]) + Half);
 		}
 		
+		// jumps the smoothers to the targets the planets' last update wrote, e.g. after they moved on unheard
+		void settle() noexcept
+		{
+			phaseSmooth.setValue(phaseBuf[0]);
+			magSmooth.setValue(magBuf[0]);
+		}
+
 		const Float* getPhaseBuf() const noexcept { return phaseBuf.data(); }
 		
 		const Float* getMagBuf() const noexcept { return magBuf.data(); }
@@ -533,21 +679,43 @@ namespace orbit
 			prepareParam(depthSmooth, depthBuf, static_cast<Float>(20), static_cast<Float>(sampleRate), blockSize);
 		}
 
-		void update(const Plnt& planet, int p, int s) noexcept
+		template<typename PlanetFloat>
+		void update(const Planet<PlanetFloat>& planet, int p, int s, int numSamples) noexcept
 		{
-			buffer[p].update(planet, s);
+			buffer[p].update(planet, s, numSamples);
 		}
 
-		void makeSmooth(float ringBufferSize, float depth, int numSamples, int numPlanets = NumPlanets) noexcept
+		/*
+		* maxTime: the longest delay of each sample in frames. constMaxTime: it holds one value throughout.
+		* with that and a settled Depth every planet runs its constant span variant
+		*/
+		void makeSmooth(const Float* maxTime, Float depth, int numSamples, int numPlanets = NumPlanets,
+			bool constMaxTime = false) noexcept
 		{
-			depthSmooth(depthBuf.data(), depth, numSamples);
+			if (depthSmooth(depthBuf.data(), depth, numSamples) && constMaxTime)
+			{
+				const auto span = depth * maxTime[0];
+				for (auto c = 0; c < numPlanets; ++c)
+					buffer[c].template makeSmooth<true>(&span, numSamples);
+				return;
+			}
+
+			for (auto s = 0; s < numSamples; ++s)
+				depthBuf[s] *= maxTime[s];
 			for (auto c = 0; c < numPlanets; ++c)
 			{
 				auto& celest = buffer[c];
-				celest.makeSmooth(depthBuf.data(), ringBufferSize, numSamples);
+				celest.template makeSmooth<false>(depthBuf.data(), numSamples);
 			}
 		}
 		
+		// call between Processor::processBlock and makeSmooth, so the planets don't glide to where they are
+		void settle(int numPlanets = NumPlanets) noexcept
+		{
+			for (auto c = 0; c < numPlanets; ++c)
+				buffer[c].settle();
+		}
+
 		const Celest& operator[](int p) const noexcept { return buffer[p]; }
 	private:
 		Buffer buffer;
@@ -567,7 +735,6 @@ namespace orbit
 		static constexpr Float RangePos = MaxPos - MinPos;
 
 		using Planets = std::array<Planet<Float>, NumPlanets>;
-		using UniBuf = UniversalBuffer<Float, NumPlanets>;
 
 		Processor(int _downsampleOrder) :
 			planets(),
@@ -646,13 +813,16 @@ namespace orbit
 			planets[p].pos.y = y;
 		}
 
-		void prepare(Float _sampleRate, int _blockSize)
+		// oversamplingOrder: see Downsample::prepare. the physics runs at the same rate either way
+		void prepare(Float _sampleRate, int _blockSize, int oversamplingOrder = 0)
 		{
-			downsample.prepare(_sampleRate, _blockSize);
+			downsample.prepare(_sampleRate, _blockSize, oversamplingOrder);
 			sampleRate = downsample.Fs;
 			sampleRateInv = static_cast<Float>(1) / sampleRate;
 		}
 
+		// uniBuf: a UniversalBuffer of any precision
+		template<typename UniBuf>
 		void processBlock(UniBuf& uniBuf, int numSamples,
 			int _numPlanets = NumPlanets,
 			Float gravity = Gravity,
@@ -663,12 +833,34 @@ namespace orbit
 
 			numPlanets.store(_numPlanets);
 
-			for (auto s = 0; s < numSamples; ++s)
+			// the planets only move at physics steps, so the buffers are filled span-wise in between
+			auto s = 0;
+			while (s < numSamples)
 			{
 				if (downsample.doProcess())
 					processSample(_numPlanets, gravity, spaceMud, attraction);
+				const auto n = std::min(numSamples - s, 1 + downsample.getNumSkippable());
+				downsample.skip(n - 1);
 				for (auto i = 0; i < _numPlanets; ++i)
-					uniBuf.update(planets[i], i, s);
+					uniBuf.update(planets[i], i, s, n);
+				s += n;
+			}
+		}
+
+		// moves the planets on like processBlock, without writing their buffers. e.g. while the delays sleep
+		void advance(int numSamples, int _numPlanets = NumPlanets, Float gravity = Gravity,
+			Float spaceMud = 1.f, Float attraction = 1.f) noexcept
+		{
+			numPlanets.store(_numPlanets);
+
+			auto s = 0;
+			while (s < numSamples)
+			{
+				if (downsample.doProcess())
+					processSample(_numPlanets, gravity, spaceMud, attraction);
+				const auto n = std::min(numSamples - s, 1 + downsample.getNumSkippable());
+				downsample.skip(n - 1);
+				s += n;
 			}
 		}
 
@@ -772,163 +964,1126 @@ public:
 		}
 	};
 
-	/********** struct WriteHead **********/
-	struct WriteHead
+	// the most channels the delays take, e.g. 7.1.4 or third order ambisonics
+	static constexpr int MaxChannels = 16;
+	static_assert(MaxChannels <= simd::MaxFrameSize, "the frame kernels read at most simd::MaxFrameSize channels");
+
+	/********** struct Delay **********/
+	/*
+	* Ring buffer of one planet. Interleaved, numChannels values per frame, sized to a power of two
+	* and mirrored by guard frames, so that the read footprint of every
+	* interpolation policy is a contiguous, unwrapped range of the storage:
+	* storage frames [0, GuardsBefore) = the ring's last GuardsBefore frames,
+	* frames GuardsBefore + k = ring[k],
+	* the GuardsAfter frames behind the ring repeat its first GuardsAfter frames
+	*/
+	template<typename Float>
+	struct Delay
 	{
-		using Buffer = std::vector<int>;
+		static constexpr int GuardsBefore = interpolation::MaxBefore;
+		static constexpr int GuardsAfter = interpolation::MaxAfter;
+		static constexpr int NumGuards = GuardsBefore + GuardsAfter;
 
-		WriteHead() :
-			buffer(),
-			wHead(-1)
+		using RingBuffer = std::vector<Float>;
+		using CompactBuffer = std::vector<std::uint16_t>;
+		using Storage = storage::Type;
+
+		Delay() :
+			ringBuffer(),
+			compactBuffer(),
+			stageBuffer(),
+			ringBufferSizeF(static_cast<Float>(1)),
+			ringBufferSize(1),
+			size(1),
+			mask(0),
+			numChannels(2),
+			ditherIdx(0),
+			storageType(Storage::Float)
 		{}
-		void prepare(int blockSize)
+
+		// _ringBufferSize: the longest delay in frames, maxBlockSize: the most frames ever written before they are read
+		void prepare(int _ringBufferSize, int maxBlockSize, int _numChannels, Storage _storageType = Storage::Float)
 		{
-			buffer.resize(blockSize, 0);
+			numChannels = _numChannels;
+			storageType = _storageType;
+			ringBufferSize = _ringBufferSize;
+			ringBufferSizeF = static_cast<Float>(ringBufferSize);
+			size = juce::nextPowerOfTwo(ringBufferSize + maxBlockSize + interpolation::MaxPoints);
+			mask = size - 1;
+			release();
+			const auto numValues = (size + NumGuards) * numChannels;
+			if (storageType == Storage::Float)
+				ringBuffer.assign(numValues + simd::MaxFrameSize, static_cast<Float>(0)); // readFrames reads past the end
+			else
+			{
+				compactBuffer.assign(numValues, 0);
+				stageBuffer.assign(maxBlockSize * numChannels, static_cast<Float>(0));
+			}
 		}
-		void operator()(int numSamples, int ringBufferSize) noexcept
+
+		void release()
 		{
-			for (auto s = 0; s < numSamples; ++s)
+			RingBuffer().swap(ringBuffer);
+			CompactBuffer().swap(compactBuffer);
+			RingBuffer().swap(stageBuffer);
+		}
+
+		/*
+		* writes samples * gain to the ring frames [w, w + numSamples) in at most two contiguous segments.
+		* gain == nullptr writes the samples as they are. numChannelsIn <= getNumChannels()
+		* midSide: stereo only, writes { l + r, l - r } * gain instead
+		*/
+		void write(const Float* const* samples, const Float* gain, int w, int numChannelsIn, int numSamples,
+			bool midSide = false) noexcept
+		{
+			switch (storageType)
 			{
-				++wHead;
-				if (wHead == ringBufferSize)
-					wHead = 0;
-				buffer[s] = wHead;
+			case Storage::Half: return write<storage::HalfFormat<Float>>(samples, gain, w, numChannelsIn, numSamples, midSide);
+			case Storage::Int16: return write<storage::Int16Format<Float>>(samples, gain, w, numChannelsIn, numSamples, midSide);
+			default: return write<storage::FloatFormat<Float>>(samples, gain, w, numChannelsIn, numSamples, midSide);
 			}
 		}
-		Buffer buffer;
+
+		/* the frames [i - before, i - before + numPoints) for any before <= GuardsBefore */
+		template<typename Format>
+		const typename Format::Sample* getFrames(int i, int before) const noexcept
+		{
+			return &getRing<Format>()[(i + GuardsBefore - before) * numChannels];
+		}
+
+		int getRingBufferSize() const noexcept { return ringBufferSize; }
+		Float getRingBufferSizeF() const noexcept { return ringBufferSizeF; }
+		int getSize() const noexcept { return size; }
+		int getMask() const noexcept { return mask; }
+		// values per frame
+		int getNumChannels() const noexcept { return numChannels; }
+		Storage getStorageType() const noexcept { return storageType; }
 	private:
-		int wHead;
+		RingBuffer ringBuffer;
+		CompactBuffer compactBuffer;
+		RingBuffer stageBuffer;
+		Float ringBufferSizeF;
+		int ringBufferSize, size, mask, numChannels;
+		std::uint32_t ditherIdx;
+		Storage storageType;
+
+		template<typename Format>
+		typename Format::Sample* getRing() noexcept
+		{
+			using Sample = typename Format::Sample;
+			if constexpr (std::is_same<Sample, Float>::value)
+				return ringBuffer.data();
+			else
+				return reinterpret_cast<Sample*>(compactBuffer.data());
+		}
+
+		template<typename Format>
+		const typename Format::Sample* getRing() const noexcept
+		{
+			return const_cast<Delay*>(this)->getRing<Format>();
+		}
+
+		template<typename Format>
+		void write(const Float* const* samples, const Float* gain, int w, int numChannelsIn, int numSamples,
+			bool midSide) noexcept
+		{
+			const auto numSamples0 = std::min(numSamples, size - w);
+			writeSegment<Format>(samples, gain, w, numChannelsIn, 0, numSamples0, midSide);
+			writeSegment<Format>(samples, gain, 0, numChannelsIn, numSamples0, numSamples - numSamples0, midSide);
+			updateGuards<Format>();
+		}
+
+		template<typename Format>
+		void writeSegment(const Float* const* samples, const Float* gain, int w,
+			int numChannelsIn, int s0, int numSamples, bool midSide) noexcept
+		{
+			using Sample = typename Format::Sample;
+			static constexpr bool IsFloat = std::is_same<Sample, Float>::value;
+
+			// compact formats are built interleaved in the stage buffer and converted in one run
+			auto ring = &getRing<Format>()[(w + GuardsBefore) * numChannels];
+			Float* dest;
+			if constexpr (IsFloat)
+				dest = ring;
+			else
+				dest = stageBuffer.data();
+
+			if (numChannels == 2 && numChannelsIn == 2 && std::is_same<Float, float>::value)
+				interleave(dest, samples[0] + s0, samples[1] + s0, gain == nullptr ? nullptr : gain + s0, numSamples, midSide);
+			else if (midSide)
+			{
+				const auto l = samples[0] + s0;
+				const auto r = samples[1] + s0;
+				for (auto s = 0; s < numSamples; ++s)
+				{
+					const auto g = gain == nullptr ? static_cast<Float>(1) : gain[s0 + s];
+					dest[s * numChannels] = (l[s] + r[s]) * g;
+					dest[s * numChannels + 1] = (l[s] - r[s]) * g;
+				}
+			}
+			else if (gain == nullptr)
+			{
+				for (auto ch = 0; ch < numChannelsIn; ++ch)
+				{
+					const auto smpls = samples[ch] + s0;
+					for (auto s = 0; s < numSamples; ++s)
+						dest[s * numChannels + ch] = smpls[s];
+				}
+			}
+			else
+			{
+				// frame-wise, so the gain is loaded once for all channels
+				const auto g = gain + s0;
+				for (auto s = 0; s < numSamples; ++s)
+				{
+					const auto gS = g[s];
+					auto frame = dest + s * numChannels;
+					for (auto ch = 0; ch < numChannelsIn; ++ch)
+						frame[ch] = samples[ch][s0 + s] * gS;
+				}
+			}
+
+			if constexpr (!IsFloat)
+			{
+				for (auto ch = numChannelsIn; ch < numChannels; ++ch)
+					for (auto s = 0; s < numSamples; ++s)
+						dest[s * numChannels + ch] = static_cast<Float>(0);
+				const auto numValues = numSamples * numChannels;
+				Format::store(ring, dest, numValues, ditherIdx);
+				ditherIdx += static_cast<std::uint32_t>(numValues);
+			}
+		}
+
+		// stereo write through the dispatched kernels. gain == nullptr writes the samples as they are
+		void interleave(Float* dest, const Float* l, const Float* r, const Float* gain, int numSamples, bool midSide) noexcept
+		{
+			if constexpr (std::is_same<Float, float>::value)
+			{
+				const auto& kernels = simd::get();
+				if (midSide)
+					kernels.interleaveMidSide(dest, l, r, gain, numSamples);
+				else if (gain == nullptr)
+					kernels.interleave(dest, l, r, numSamples);
+				else
+					kernels.interleaveGain(dest, l, r, gain, numSamples);
+			}
+		}
+
+		template<typename Format>
+		void updateGuards() noexcept
+		{
+			auto ring = getRing<Format>();
+			std::copy(
+				ring + size * numChannels,
+				ring + (size + GuardsBefore) * numChannels,
+				ring);
+			std::copy(
+				ring + GuardsBefore * numChannels,
+				ring + NumGuards * numChannels,
+				ring + (size + GuardsBefore) * numChannels);
+		}
 	};
 
-	template<typename Float>
-	inline Float cubicHermiteSpline(const Float* buffer, const Float readHead, const int size) noexcept
+	/*
+	* Planet-parallel multi-tap engine.
+	* Walks the block in tiles of TileSize samples. Each tile's input is first written
+	* into every planet's ring, then the read positions and tap weights of Lanes planets
+	* are computed side by side (one SIMD op per lane group) and every planet's taps are
+	* gathered from its ring and mixed straight into the output.
+	* Reads trail the write head by ReadOffset frames so the newest frame of the largest
+	* interpolation footprint was always written already. The offset is the same for
+	* every interpolation type, so switching types doesn't move the taps.
+	* Works in-place: samples is both the planet bus input and the summed output. A
+	* tile's input is written into the rings straight from samples before any tap is
+	* read, so the taps are then mixed into the same tile, gain included, without
+	* copying the input or keeping an accumulator.
+	*
+	* With sharedHistory the input is written once into a single history ring instead
+	* of once per planet. Each planet's write gain (-mag) is kept in a small ring
+	* decimated by GainDecimation, which is read at the tap's position, so the gain is
+	* the one of the moment the sample was written, like with the per-planet rings.
+	*
+	* Planets whose taps are provably inaudible are culled: a planet's contribution is
+	* bounded by the peak of |input * mag| over the ring, so once that product stayed
+	* below CullThreshold for a whole ring length, nothing in the ring can become
+	* audible and its write and read are skipped after a FadeLength fade-out. It returns
+	* at full gain from the first tile it exceeds the threshold again: its ring only
+	* holds quiet samples then, while a fade-in would duck the onset of short delays.
+	* Only the active planets are packed into the lane groups.
+	*
+	* Any number of channels up to MaxChannels is processed in one pass: read positions,
+	* tap weights, gains and fades are computed once per planet and shared by all channels,
+	* and the rings are interleaved, so a tap's channels are read with vectors across them.
+	*
+	* With midSide a stereo input is encoded to mid/side as it's written into the rings,
+	* and the taps are decoded back to left/right as they are mixed into the output. The
+	* encoder's .5 is part of the output gain.
+	*
+	* Given a workers::Pool of more than one thread, the planets are split into jobs of
+	* PlanetsPerJob. A job walks the whole block for its planets and mixes them into its
+	* own partial buffer, the partials are then summed in job order. The split neither
+	* depends on the number of threads nor on which thread runs a job, so the output is
+	* the same with any number of threads. The shared history is written for the whole
+	* block before the jobs start, its ring has room for that. While the pool is degraded
+	* to the audio thread all planets run as one job again, which only differs from the
+	* split in the rounding of the sum.
+	*/
+	template<typename Float, size_t NumPlanets>
+	struct MultiTap
 	{
-		const auto iFloor = std::floor(readHead);
-		auto i1 = static_cast<int>(iFloor);
-		auto i0 = i1 - 1;
-		auto i2 = i1 + 1;
-		auto i3 = i1 + 2;
-		if (i3 >= size) i3 -= size;
-		if (i2 >= size) i2 -= size;
-		if (i0 < 0) i0 += size;
-
-		const auto t = readHead - iFloor;
-		const auto v0 = buffer[i0];
-		const auto v1 = buffer[i1];
-		const auto v2 = buffer[i2];
-		const auto v3 = buffer[i3];
-
-		const auto c0 = v1;
-		const auto c1 = static_cast<Float>(.5) * (v2 - v0);
-		const auto c2 = v0 - static_cast<Float>(2.5) * v1 + static_cast<Float>(2) * v2 - static_cast<Float>(.5) * v3;
-		const auto c3 = static_cast<Float>(1.5) * (v1 - v2) + static_cast<Float>(.5) * (v3 - v0);
-
-		return ((c3 * t + c2) * t + c1) * t + c0;
-	}
+		static constexpr int Lanes = 8;
+		static constexpr int TileSize = 64;
+		static constexpr int NumGroups = (static_cast<int>(NumPlanets) + Lanes - 1) / Lanes;
+		static constexpr Float ReadOffset = static_cast<Float>(interpolation::MaxAfter - 1);
+		static constexpr int GainDecimationLog2 = 4;
+		static constexpr int GainDecimation = 1 << GainDecimationLog2;
+		static constexpr Float CullThreshold = static_cast<Float>(1e-5); // -100 dB
+		static constexpr int FadeLength = 2 * TileSize;
+		static constexpr int PlanetsPerJob = Lanes / 2;
+		static constexpr int MaxJobs = (static_cast<int>(NumPlanets) + PlanetsPerJob - 1) / PlanetsPerJob;
+
+		enum class Cull { Active, FadingOut, Culled };
 
-	/********** struct Delay **********/
-	template<typename Float>
-	struct Delay
-	{
+		using Delay = Delay<Float>;
+		using DelayBuf = std::array<Delay, NumPlanets>;
+		using UniBuf = UniversalBuffer<Float, NumPlanets>;
+		using Lane = std::array<Float, Lanes>;
+		using LaneInt = std::array<int, Lanes>;
+		using Tile = std::array<Float, TileSize>;
+		using TileLanes = std::array<Lane, TileSize>;
+		using Weights = std::array<Lane, interpolation::MaxPoints>;
+		using AllpassState = std::array<std::array<Float, NumPlanets>, MaxChannels>;
+		using GainHistory = std::array<std::vector<Float>, NumPlanets>;
+		using PlanetInt = std::array<int, NumPlanets>;
+		using PlanetFloat = std::array<Float, NumPlanets>;
+		using PlanetCull = std::array<Cull, NumPlanets>;
+		using Buf = std::vector<Float>;
+		using Interpolation = interpolation::Type;
+		using Storage = storage::Type;
+
+		/********** struct Job **********/
+		// the planets [p0, p1) and everything the tile being mixed needs of them
+		struct Job
+		{
+			Job() :
+				activeIdx(),
+				fadeStart(), fadeInc(),
+				phaseTile(),
+				gainTile(),
+				partial(),
+				out(), outTile(),
+				p0(0), p1(0),
+				numActive(0),
+				wHead(0),
+				firstGroup(true),
+				writeHistory(true)
+			{}
+
+			PlanetInt activeIdx;
+			PlanetFloat fadeStart, fadeInc;
+			TileLanes phaseTile;
+			Tile gainTile;
+			std::array<Buf, MaxChannels> partial;
+			std::array<Float*, MaxChannels> out, outTile;
+			int p0, p1, numActive, wHead;
+			bool firstGroup, writeHistory;
+		};
+
+		MultiTap() :
+			delays(),
+			history(),
+			gainHistory(),
+			jobs(),
+			tilePeaks(),
+			allpassState(),
+			cull(), quietFor(),
+			fade(),
+			samples(nullptr),
+			uniBuf(nullptr),
+			gain(static_cast<Float>(1)),
+			maxDelay(static_cast<Float>(0)),
+			numPlanets(0), numChannels(0), numSamples(0),
+			ringChannels(2),
+			ringMask(0), gainMask(0),
+			wHead(0),
+			numActiveTaps(0),
+			sharedHistory(false), midSide(false),
+			storageType(Storage::Float)
+		{}
 
-		using RingBuffer = std::array<std::vector<Float>, 2>;
-		using WHeadBuf = std::vector<int>;
-		using CelestialBuf = CelestialBuffer<Float>;
-		using Samples = std::array<std::vector<Float>, 2>;
+		// ringBufferSize: the longest delay in frames, _numChannels: the most channels ever processed
+		void prepare(int ringBufferSize, int maxBlockSize, int _numChannels, bool _sharedHistory = false,
+			Storage _storageType = Storage::Float)
+		{
+			ringChannels = juce::jlimit(1, MaxChannels, _numChannels);
+			sharedHistory = _sharedHistory;
+			storageType = _storageType;
+			maxDelay = static_cast<Float>(ringBufferSize);
+			if (sharedHistory)
+			{
+				history.prepare(ringBufferSize, maxBlockSize, ringChannels, storageType);
+				ringMask = history.getMask();
+				gainMask = (history.getSize() >> GainDecimationLog2) - 1;
+				for (auto& delay : delays)
+					delay.release();
+				for (auto& g : gainHistory)
+					g.assign(gainMask + 1, static_cast<Float>(0));
+			}
+			else
+			{
+				history.release();
+				for (auto& delay : delays)
+					delay.prepare(ringBufferSize, TileSize, ringChannels, storageType);
+				ringMask = delays[0].getMask();
+				for (auto& g : gainHistory)
+					Buf().swap(g);
+			}
+			for (auto& job : jobs)
+				for (auto ch = 0; ch < MaxChannels; ++ch)
+				{
+					if (ch < ringChannels)
+						job.partial[ch].assign(maxBlockSize, static_cast<Float>(0));
+					else
+						Buf().swap(job.partial[ch]);
+				}
+			tilePeaks.assign(maxBlockSize / TileSize + 1, static_cast<Float>(0));
+			wHead = 0;
+			for (auto& ch : allpassState)
+				ch.fill(static_cast<Float>(0));
+			cull.fill(Cull::Active);
+			quietFor.fill(0);
+			fade.fill(static_cast<Float>(1));
+			numActiveTaps.store(static_cast<int>(NumPlanets));
+		}
+
+		// pool: splits the planets across its threads, if it has more than one. channels beyond the prepared ones pass
+		// _midSide: process a stereo input in mid/side. ignored for any other number of channels
+		void operator()(Float** _samples, const UniBuf& _uniBuf, Float _gain,
+			int _numPlanets, int _numChannels, int _numSamples,
+			Interpolation type = Interpolation::Hermite, workers::Pool* pool = nullptr, bool _midSide = false) noexcept
+		{
+			samples = _samples;
+			uniBuf = &_uniBuf;
+			numPlanets = _numPlanets;
+			numChannels = std::min(_numChannels, ringChannels);
+			numSamples = _numSamples;
+			midSide = _midSide && numChannels == 2;
+			gain = midSide ? _gain * static_cast<Float>(.5) : _gain;
+
+			switch (type)
+			{
+			case Interpolation::Linear: return process<interpolation::Linear<Float>>(pool);
+			case Interpolation::Lagrange4: return process<interpolation::Lagrange4<Float>>(pool);
+			case Interpolation::Lagrange6: return process<interpolation::Lagrange6<Float>>(pool);
+			case Interpolation::Allpass: return process<interpolation::Allpass<Float>>(pool);
+			case Interpolation::Sinc: return process<interpolation::Sinc16<Float>>(pool);
+			default: return process<interpolation::Hermite<Float>>(pool);
+			}
+		}
 
-		Delay() :
-			ringBuffer(),
-			ringBufferSizeF(static_cast<Float>(1)),
-			ringBufferSize(1)
-		{}
+		Float getRingBufferSizeF() const noexcept { return maxDelay; }
+		// frames a planet stays active once its input went quiet, before it fades out
+		int getRingSize() const noexcept { return ringMask + 1; }
+		// planets that were read in the last tile. any thread
+		int getNumActiveTaps() const noexcept { return numActiveTaps.load(std::memory_order_relaxed); }
+	private:
+		DelayBuf delays;
+		Delay history;
+		GainHistory gainHistory;
+		std::array<Job, MaxJobs> jobs;
+		Buf tilePeaks;
+		AllpassState allpassState;
+		PlanetCull cull;
+		PlanetInt quietFor;
+		PlanetFloat fade;
+		// the block being processed
+		Float** samples;
+		const UniBuf* uniBuf;
+		Float gain, maxDelay;
+		int numPlanets, numChannels, numSamples;
+		int ringChannels, ringMask, gainMask, wHead;
+		std::atomic<int> numActiveTaps;
+		bool sharedHistory, midSide;
+		Storage storageType;
+
+		template<typename Interp>
+		void process(workers::Pool* pool) noexcept
+		{
+			switch (storageType)
+			{
+			case Storage::Half: return process<Interp, storage::HalfFormat<Float>>(pool);
+			case Storage::Int16: return process<Interp, storage::Int16Format<Float>>(pool);
+			default: return process<Interp, storage::FloatFormat<Float>>(pool);
+			}
+		}
 
-		void prepare(double sampleRate, int blockSize)
+		template<typename Interp, typename Format>
+		void process(workers::Pool* pool) noexcept
 		{
-			ringBufferSize = static_cast<int>(sampleRate * .04); // 40ms
-			ringBufferSizeF = static_cast<Float>(ringBufferSize);
-			for(auto& r: ringBuffer)
-				r.resize(ringBufferSize + 4);
+			measureInput();
+
+			const auto numJobs = (numPlanets + PlanetsPerJob - 1) / PlanetsPerJob;
+			if (pool == nullptr || !pool->isParallel())
+			{
+				// one job of full lanes is cheaper than the split when it runs on this thread anyway
+				const auto start = juce::Time::getHighResolutionTicks();
+				auto& job = jobs[0];
+				job.p0 = 0;
+				job.p1 = numPlanets;
+				job.writeHistory = true;
+				for (auto ch = 0; ch < numChannels; ++ch)
+					job.out[ch] = samples[ch];
+				processJob<Interp, Format>(job);
+				numActiveTaps.store(job.numActive, std::memory_order_relaxed);
+				if (pool != nullptr)
+					pool->skip(juce::Time::getHighResolutionTicks() - start, numJobs);
+			}
+			else
+			{
+				if (sharedHistory)
+					history.write(samples, nullptr, wHead, numChannels, numSamples, midSide);
+
+				for (auto j = 0; j < numJobs; ++j)
+				{
+					auto& job = jobs[j];
+					job.p0 = j * PlanetsPerJob;
+					job.p1 = std::min(job.p0 + PlanetsPerJob, numPlanets);
+					job.writeHistory = false;
+					for (auto ch = 0; ch < numChannels; ++ch)
+						job.out[ch] = job.partial[ch].data();
+				}
+				pool->run(&runJob<Interp, Format>, this, numJobs);
+
+				auto numActive = 0;
+				for (auto ch = 0; ch < numChannels; ++ch)
+					juce::FloatVectorOperations::copy(samples[ch], jobs[0].out[ch], numSamples);
+				for (auto j = 0; j < numJobs; ++j)
+				{
+					numActive += jobs[j].numActive;
+					if (j != 0)
+						for (auto ch = 0; ch < numChannels; ++ch)
+							juce::FloatVectorOperations::add(samples[ch], jobs[j].out[ch], numSamples);
+				}
+				numActiveTaps.store(numActive, std::memory_order_relaxed);
+			}
+
+			wHead = (wHead + numSamples) & ringMask;
 		}
 
-		void operator()(Samples& samples, const int* wHead, const CelestialBuf& celestial,
-			int numChannels, int numSamples) noexcept
+		template<typename Interp, typename Format>
+		static void runJob(void* context, int j) noexcept
 		{
-			const auto phaseBuf = celestial.getPhaseBuf();
-			const auto magBuf = celestial.getMagBuf();
+			auto& multiTap = *static_cast<MultiTap*>(context);
+			multiTap.template processJob<Interp, Format>(multiTap.jobs[j]);
+		}
+
+		// the input's peak of each tile, for culling. in mid/side including the encoder's .5
+		void measureInput() noexcept
+		{
+			for (auto t0 = 0; t0 < numSamples; t0 += TileSize)
+			{
+				const auto tileSize = std::min(TileSize, numSamples - t0);
+				auto peak = static_cast<Float>(0);
+				if (midSide)
+				{
+					const auto l = samples[0] + t0;
+					const auto r = samples[1] + t0;
+					for (auto s = 0; s < tileSize; ++s)
+						peak = std::max(peak, std::max(std::abs(l[s] + r[s]), std::abs(l[s] - r[s])));
+					peak *= static_cast<Float>(.5);
+				}
+				else
+					for (auto ch = 0; ch < numChannels; ++ch)
+					{
+						const auto smpls = samples[ch] + t0;
+						for (auto s = 0; s < tileSize; ++s)
+							peak = std::max(peak, std::abs(smpls[s]));
+					}
+				tilePeaks[t0 / TileSize] = peak;
+			}
+		}
+
+		template<typename Interp, typename Format>
+		void processJob(Job& job) noexcept
+		{
+			for (auto t0 = 0; t0 < numSamples; t0 += TileSize)
+			{
+				const auto tileSize = std::min(TileSize, numSamples - t0);
+				job.wHead = (wHead + t0) & ringMask;
+				processTile<Interp, Format>(job, t0, tileSize);
+			}
+		}
 
+		template<typename Interp, typename Format>
+		void processTile(Job& job, int t0, int tileSize) noexcept
+		{
+			std::array<const Float*, MaxChannels> in;
 			for (auto ch = 0; ch < numChannels; ++ch)
 			{
-				auto ring = ringBuffer[ch].data();
-				auto smpls = samples[ch].data();
-				for (auto s = 0; s < numSamples; ++s)
+				in[ch] = samples[ch] + t0;
+				job.outTile[ch] = job.out[ch] + t0;
+			}
+
+			updateCulling(job, tilePeaks[t0 / TileSize], t0, tileSize);
+
+			// the gain history stays complete even for culled planets, it's read as soon as they return
+			if (sharedHistory)
+			{
+				if (job.writeHistory)
+					history.write(in.data(), nullptr, job.wHead, numChannels, tileSize, midSide);
+				for (auto p = job.p0; p < job.p1; ++p)
+					writeGainHistory(job.wHead, (*uniBuf)[p].getMagBuf() + t0, gainHistory[p].data(), tileSize);
+			}
+			else
+				for (auto i = 0; i < job.numActive; ++i)
+				{
+					const auto p = job.activeIdx[i];
+					const auto magBuf = (*uniBuf)[p].getMagBuf() + t0;
+					for (auto s = 0; s < tileSize; ++s)
+						job.gainTile[s] = -magBuf[s];
+					delays[p].write(in.data(), job.gainTile.data(), job.wHead, numChannels, tileSize, midSide);
+				}
+
+			// from here on the tile's input only lives in the rings
+			if (job.numActive == 0)
+				for (auto ch = 0; ch < numChannels; ++ch)
+					std::fill(job.outTile[ch], job.outTile[ch] + tileSize, static_cast<Float>(0));
+			for (auto g = 0; g < NumGroups; ++g)
+			{
+				const auto a0 = g * Lanes;
+				const auto numLanes = std::min(Lanes, job.numActive - a0);
+				if (numLanes <= 0)
+					break;
+				const auto lanes = &job.activeIdx[a0];
+				loadGroup(job, lanes, numLanes, t0, tileSize);
+				auto fading = false;
+				for (auto l = 0; l < numLanes; ++l)
+					fading |= cull[lanes[l]] != Cull::Active;
+				job.firstGroup = g == 0;
+				if (numLanes <= Lanes / 2)
+					for (auto s = 0; s < tileSize; ++s)
+						processSample<Interp, Format, Lanes / 2>(job, lanes, numLanes, s, fading);
+				else
+					for (auto s = 0; s < tileSize; ++s)
+						processSample<Interp, Format, Lanes>(job, lanes, numLanes, s, fading);
+			}
+
+			finishFades(job, tileSize);
+		}
+
+		/*
+		* advances the culling state of the job's planets by one tile and lists the ones to
+		* process in activeIdx. a planet counts as loud if its input * mag peak exceeds CullThreshold
+		*/
+		void updateCulling(Job& job, Float inPeak, int t0, int tileSize) noexcept
+		{
+			static constexpr auto FadeInc = static_cast<Float>(1) / static_cast<Float>(FadeLength);
+			const auto ringSize = ringMask + 1;
+
+			job.numActive = 0;
+			for (auto p = job.p0; p < job.p1; ++p)
+			{
+				const auto magBuf = (*uniBuf)[p].getMagBuf() + t0;
+				auto magPeak = static_cast<Float>(0);
+				for (auto s = 0; s < tileSize; ++s)
+					magPeak = std::max(magPeak, std::abs(magBuf[s]));
+
+				auto& state = cull[p];
+				if (inPeak * magPeak > CullThreshold)
 				{
-					const auto w = wHead[s];
-					
-					const auto phase = phaseBuf[s];
-					auto r = static_cast<Float>(w) - phase;
-					if (r < static_cast<Float>(0))
-						r += ringBufferSize;
+					quietFor[p] = 0;
+					state = Cull::Active;
+					fade[p] = static_cast<Float>(1);
+				}
+				else
+				{
+					quietFor[p] = std::min(quietFor[p] + tileSize, ringSize);
+					if (state != Cull::Culled && quietFor[p] >= ringSize)
+						state = Cull::FadingOut;
+				}
 
-					const auto mag = magBuf[s];
+				if (state == Cull::Culled)
+					continue;
+				const auto i = job.numActive;
+				job.fadeStart[i] = fade[p];
+				job.fadeInc[i] = state == Cull::FadingOut ? -FadeInc : static_cast<Float>(0);
+				job.activeIdx[i] = p;
+				++job.numActive;
+			}
+		}
 
-					const auto sOut = cubicHermiteSpline(ring, r, ringBufferSize);
-					const auto sIn = smpls[s] * -mag; + sOut;
+		// moves the fade-outs of the tile's planets on and culls the ones that faded out
+		void finishFades(const Job& job, int tileSize) noexcept
+		{
+			for (auto i = 0; i < job.numActive; ++i)
+			{
+				const auto p = job.activeIdx[i];
+				auto& state = cull[p];
+				if (state != Cull::FadingOut)
+					continue;
+				fade[p] = std::max(job.fadeStart[i] + static_cast<Float>(tileSize) * job.fadeInc[i], static_cast<Float>(0));
+				if (fade[p] == static_cast<Float>(0))
+				{
+					state = Cull::Culled;
+					for (auto& ch : allpassState)
+						ch[p] = static_cast<Float>(0);
+				}
+			}
+		}
 
-					ring[w] = sIn;
-					smpls[s] = sOut;
+		/*
+		* stores -mag at every GainDecimation'th ring frame of the tile at w and, provisionally,
+		* at the next such frame after it, so reads in the newest frames have both neighbours
+		*/
+		void writeGainHistory(int w, const Float* magBuf, Float* gains, int tileSize) noexcept
+		{
+			const auto s0 = (GainDecimation - (w & (GainDecimation - 1))) & (GainDecimation - 1);
+			for (auto s = s0; s < tileSize; s += GainDecimation)
+				gains[((w + s) >> GainDecimationLog2) & gainMask] = -magBuf[s];
+			const auto wLast = w + tileSize - 1;
+			gains[((wLast >> GainDecimationLog2) + 1) & gainMask] = -magBuf[tileSize - 1];
+		}
+
+		// transposes the group's read positions into [sample][lane], limited to the ring
+		void loadGroup(Job& job, const int* lanes, int numLanes, int t0, int tileSize) noexcept
+		{
+			auto& phaseTile = job.phaseTile;
+			for (auto l = 0; l < Lanes; ++l)
+			{
+				if (l < numLanes)
+				{
+					const auto phaseBuf = (*uniBuf)[lanes[l]].getPhaseBuf() + t0;
+					for (auto s = 0; s < tileSize; ++s)
+						phaseTile[s][l] = std::min(phaseBuf[s], maxDelay);
 				}
+				else
+					for (auto s = 0; s < tileSize; ++s)
+						phaseTile[s][l] = static_cast<Float>(0);
 			}
 		}
 
-		int getRingBufferSize() const noexcept { return ringBufferSize; }
-		Float getRingBufferSizeF() const noexcept { return ringBufferSizeF; }
-	private:
-		RingBuffer ringBuffer;
-		Float ringBufferSizeF;
-		int ringBufferSize;
-	};
+		template<typename Interp, typename Format, int NumLanes>
+		void processSample(Job& job, const int* lanes, int numLanes, int s, bool fading) noexcept
+		{
+			// read position = w - (ReadOffset + phase), split into whole frames and a fraction
+			const auto w = job.wHead + s;
+			const auto& phase = job.phaseTile[s];
+
+			// lane-parallel: read positions and tap weights of all planets in the group
+			Lane t, feedback;
+			LaneInt idx;
+			Weights weights;
+			for (auto l = 0; l < NumLanes; ++l)
+			{
+				const auto d = ReadOffset + phase[l];
+				const auto dFloor = std::floor(d);
+				idx[l] = (w - static_cast<int>(dFloor) - 1) & ringMask;
+				t[l] = static_cast<Float>(1) - (d - dFloor);
+			}
+			Interp::template weights<NumLanes>(t, weights, feedback);
+			if (sharedHistory)
+				applyGainHistory<Interp, NumLanes>(lanes, numLanes, idx, t, weights);
+			if (fading)
+				applyFades<Interp, NumLanes>(job, lanes - job.activeIdx.data(), numLanes, s, weights);
+
+			if constexpr (std::is_same<typename Format::Sample, float>::value)
+			{
+				if (numChannels == 2 && ringChannels == 2)
+					return gatherStereo<Interp, Format>(job, lanes, numLanes, s, idx, weights, feedback);
+				if (numChannels > 2 && numChannels == ringChannels)
+					return gatherFrames<Interp, Format>(job, lanes, numLanes, s, idx, weights, feedback);
+			}
+
+			gatherChannels<Interp, Format>(job, lanes, numLanes, s, idx, weights, feedback);
+		}
 
-	/********** struct Delays **********/
+		// gather and mix of float rings of more than 2 channels through the dispatched frame read kernel
+		template<typename Interp, typename Format>
+		void gatherFrames(Job& job, const int* lanes, int numLanes, int s, const LaneInt& idx, const Weights& weights, const Lane& feedback) noexcept
+		{
+			std::array<const float*, Lanes> frames;
+			for (auto l = 0; l < numLanes; ++l)
+			{
+				const auto& ring = sharedHistory ? history : delays[lanes[l]];
+				frames[l] = ring.template getFrames<Format>(idx[l], Interp::Before);
+			}
+
+			std::array<float, Lanes * simd::MaxFrameSize> y;
+			simd::get().readFrames(frames.data(), weights[0].data(), Lanes, Interp::NumPoints, numLanes, numChannels, y.data());
+
+			std::array<Float, MaxChannels> sum;
+			std::fill(sum.begin(), sum.begin() + numChannels, static_cast<Float>(0));
+			for (auto l = 0; l < numLanes; ++l)
+				for (auto ch = 0; ch < numChannels; ++ch)
+				{
+					auto yCh = y[l * simd::MaxFrameSize + ch];
+					if constexpr (Interp::Recursive)
+					{
+						auto& y1 = allpassState[ch][lanes[l]];
+						yCh -= feedback[l] * y1;
+						y1 = yCh;
+					}
+					sum[ch] += yCh;
+				}
+			for (auto ch = 0; ch < numChannels; ++ch)
+				mix(job, ch, s, sum[ch]);
+		}
+
+		/*
+		* gather and mix of any number of channels. the tap weights are shared by all channels and
+		* a frame's channels are contiguous, so the innermost loop runs across the channels
+		*/
+		template<typename Interp, typename Format>
+		void gatherChannels(Job& job, const int* lanes, int numLanes, int s, const LaneInt& idx, const Weights& weights, const Lane& feedback) noexcept
+		{
+			std::array<Float, MaxChannels> sum, y;
+			std::fill(sum.begin(), sum.begin() + numChannels, static_cast<Float>(0));
+			for (auto l = 0; l < numLanes; ++l)
+			{
+				const auto& ring = sharedHistory ? history : delays[lanes[l]];
+				const auto frames = ring.template getFrames<Format>(idx[l], Interp::Before);
+				std::fill(y.begin(), y.begin() + numChannels, static_cast<Float>(0));
+				for (auto k = 0; k < Interp::NumPoints; ++k)
+				{
+					const auto w = weights[k][l];
+					const auto frame = frames + k * ringChannels;
+					for (auto ch = 0; ch < numChannels; ++ch)
+						y[ch] += Format::load(frame[ch]) * w;
+				}
+				for (auto ch = 0; ch < numChannels; ++ch)
+				{
+					if constexpr (Interp::Recursive)
+					{
+						auto& y1 = allpassState[ch][lanes[l]];
+						y[ch] -= feedback[l] * y1;
+						y1 = y[ch];
+					}
+					sum[ch] += y[ch];
+				}
+			}
+			if (midSide)
+				return mixMidSide(job, s, sum[0], sum[1]);
+			for (auto ch = 0; ch < numChannels; ++ch)
+				mix(job, ch, s, sum[ch]);
+		}
+
+		// gather and mix of float rings through the dispatched stereo read kernel
+		template<typename Interp, typename Format>
+		void gatherStereo(Job& job, const int* lanes, int numLanes, int s, const LaneInt& idx, Weights& weights, const Lane& feedback) noexcept
+		{
+			static constexpr int NumChannels = 2;
+			// the kernel reads whole vectors of points, the weights beyond the policy's points must be zero
+			static constexpr int NumPointsPadded = std::min(interpolation::MaxPoints, (Interp::NumPoints + 7) & ~7);
+			for (auto k = Interp::NumPoints; k < NumPointsPadded; ++k)
+				weights[k].fill(static_cast<Float>(0));
+
+			std::array<const float*, Lanes> frames;
+			for (auto l = 0; l < numLanes; ++l)
+			{
+				const auto& ring = sharedHistory ? history : delays[lanes[l]];
+				frames[l] = ring.template getFrames<Format>(idx[l], Interp::Before);
+			}
+
+			std::array<float, Lanes * NumChannels> y;
+			simd::get().readStereo(frames.data(), weights[0].data(), Lanes, Interp::NumPoints, numLanes, y.data());
+
+			std::array<Float, NumChannels> sum = { static_cast<Float>(0), static_cast<Float>(0) };
+			for (auto l = 0; l < numLanes; ++l)
+				for (auto ch = 0; ch < NumChannels; ++ch)
+				{
+					auto yCh = y[l * NumChannels + ch];
+					if constexpr (Interp::Recursive)
+					{
+						auto& y1 = allpassState[ch][lanes[l]];
+						yCh -= feedback[l] * y1;
+						y1 = yCh;
+					}
+					sum[ch] += yCh;
+				}
+			if (midSide)
+				return mixMidSide(job, s, sum[0], sum[1]);
+			for (auto ch = 0; ch < NumChannels; ++ch)
+				mix(job, ch, s, sum[ch]);
+		}
+
+		// the first lane group overwrites the tile's input, the others add to it
+		void mix(Job& job, int ch, int s, Float sum) noexcept
+		{
+			auto& y = job.outTile[ch][s];
+			y = job.firstGroup ? sum * gain : y + sum * gain;
+		}
+
+		// decodes the mid/side taps while mixing them
+		void mixMidSide(Job& job, int s, Float mid, Float side) noexcept
+		{
+			mix(job, 0, s, mid + side);
+			mix(job, 1, s, mid - side);
+		}
+
+		// scales the tap weights by each planet's write gain at the read position
+		template<typename Interp, int NumLanes>
+		void applyGainHistory(const int* lanes, int numLanes, const LaneInt& idx, const Lane& t, Weights& weights) noexcept
+		{
+			static constexpr auto DecimationInv = static_cast<Float>(1) / static_cast<Float>(GainDecimation);
+
+			Lane gains;
+			for (auto l = 0; l < numLanes; ++l)
+			{
+				const auto x = (static_cast<Float>(idx[l]) + t[l]) * DecimationInv;
+				const auto xFloor = std::floor(x);
+				const auto i = static_cast<int>(xFloor);
+				const auto decimated = gainHistory[lanes[l]].data();
+				const auto g0 = decimated[i & gainMask];
+				const auto g1 = decimated[(i + 1) & gainMask];
+				gains[l] = g0 + (x - xFloor) * (g1 - g0);
+			}
+			for (auto k = 0; k < Interp::NumPoints; ++k)
+				for (auto l = 0; l < NumLanes; ++l)
+					weights[k][l] *= l < numLanes ? gains[l] : static_cast<Float>(0);
+		}
+
+		// scales the tap weights by the fade-out of the planets that are being culled
+		template<typename Interp, int NumLanes>
+		void applyFades(const Job& job, std::ptrdiff_t a0, int numLanes, int s, Weights& weights) noexcept
+		{
+			const auto x = static_cast<Float>(s);
+			Lane gains;
+			for (auto l = 0; l < NumLanes; ++l)
+				gains[l] = l < numLanes ?
+					std::max(job.fadeStart[a0 + l] + x * job.fadeInc[a0 + l], static_cast<Float>(0)) :
+					static_cast<Float>(0);
+			for (auto k = 0; k < Interp::NumPoints; ++k)
+				for (auto l = 0; l < NumLanes; ++l)
+					weights[k][l] *= gains[l];
+		}
+	};
+	/*
+	* Sizes the MultiTap's rings to the Max Time parameter.
+	* The audio thread never allocates: when Max Time needs more ring, or less than
+	* 1 / ShrinkFactor of it, a request goes to a background thread, which prepares a
+	* second MultiTap of the new size. The audio thread then runs both engines on the
+	* same input, limited to the smaller of the two rings, until the new one has heard
+	* enough history to sound like the old one, crossfades over FadeLengthMs and hands
+	* the old engine back to the background thread to be freed.
+	* Max Time is smoothed here, so the delays glide to a longer range once a larger
+	* ring is in place.
+	*/
 	template<typename Float, size_t NumPlanets>
-	struct Delays
+	struct ResizingMultiTap :
+		public juce::Thread
 	{
-		using Delay = Delay<Float>;
-		using DelayBuf = std::array<Delay, NumPlanets>;
+		static constexpr int ShrinkFactor = 4;
+		static constexpr int AllocatorIntervalMs = 10;
+		static constexpr Float FadeLengthMs = static_cast<Float>(20);
+		static constexpr Float TimeSmoothMs = static_cast<Float>(200);
+
+		enum class State { Idle, Requested, Ready, Fading, Retired };
+
+		using Engine = MultiTap<Float, NumPlanets>;
+		using EnginePtr = std::unique_ptr<Engine>;
 		using UniBuf = UniversalBuffer<Float, NumPlanets>;
-		using Samples = std::array<std::array<std::vector<Float>, 2>, NumPlanets>;
+		using Interpolation = interpolation::Type;
+		using Storage = storage::Type;
+		using Buf = std::vector<Float>;
 
-		Delays() :
-			wHead(),
-			delays()
+		ResizingMultiTap() :
+			juce::Thread("NELOrbit Delay Allocator"),
+			engines(),
+			state(State::Idle),
+			requestedSize(0),
+			active(0),
+			timeSmooth(),
+			timeBuf(),
+			fadeBuf(),
+			sampleRate(static_cast<Float>(48000)),
+			fadeInc(static_cast<Float>(0)),
+			fadePhase(static_cast<Float>(0)),
+			warmup(0),
+			maxBlockSize(0),
+			numChannels(2),
+			sharedHistory(false),
+			constMaxTime(false),
+			storageType(Storage::Float)
 		{}
 
-		void prepare(double sampleRate, int blockSize)
+		~ResizingMultiTap() override
 		{
-			wHead.prepare(blockSize);
-			for (auto& delay : delays)
-				delay.prepare(sampleRate, blockSize);
+			stopThread(1000);
 		}
 
-		void operator()(Samples& samples, const UniBuf& uniBuf,
-			int numPlanets, int numChannels, int numSamples) noexcept
+		// call from prepareToPlay. allocates synchronously for the current maxTimeMs
+		void prepare(Float _sampleRate, int blockSize, int _numChannels, Float maxTimeMs,
+			bool _sharedHistory = false, Storage _storageType = Storage::Float)
 		{
-			wHead(numSamples, delays[0].getRingBufferSize());
-			for (auto d = 0; d < numPlanets; ++d)
+			stopThread(1000);
+			sampleRate = _sampleRate;
+			maxBlockSize = blockSize;
+			numChannels = juce::jlimit(1, MaxChannels, _numChannels);
+			sharedHistory = _sharedHistory;
+			storageType = _storageType;
+			fadeInc = static_cast<Float>(1000) / (FadeLengthMs * sampleRate);
+
+			const auto ringBufferSize = getRingBufferSize(msToSamples(maxTimeMs));
+			active = 0;
+			if (engines[0] == nullptr)
+				engines[0] = std::make_unique<Engine>();
+			engines[0]->prepare(ringBufferSize, maxBlockSize, numChannels, sharedHistory, storageType);
+			engines[1].reset();
+			state.store(State::Idle);
+
+			prepareParam(timeSmooth, timeBuf, TimeSmoothMs, sampleRate, blockSize);
+			timeSmooth.setValue(msToSamples(maxTimeMs));
+			for (auto ch = 0; ch < MaxChannels; ++ch)
 			{
-				auto& delay = delays[d];
-				delay(
-					samples[d],
-					wHead.buffer.data(),
-					uniBuf[d],
-					numChannels,
-					numSamples
-				);
+				if (ch < numChannels)
+					fadeBuf[ch].assign(blockSize, static_cast<Float>(0));
+				else
+					Buf().swap(fadeBuf[ch]);
 			}
+
+			startThread();
 		}
 
-		Float getRingBufferSizeF() const noexcept { return delays[0].getRingBufferSizeF(); }
+		// frees the rings, e.g. of a chain the host doesn't use
+		void release()
+		{
+			stopThread(1000);
+			for (auto& engine : engines)
+				engine.reset();
+			active = 0;
+			state.store(State::Idle);
+		}
+
+		/*
+		* call before UniversalBuffer::makeSmooth. requests and adopts new rings and
+		* returns the smoothed Max Time in frames, limited to the rings in place
+		*/
+		const Float* updateMaxTime(Float maxTimeMs, int numSamples) noexcept
+		{
+			const auto target = msToSamples(maxTimeMs);
+			auto& engine = *engines[active];
+
+			if (state.load() == State::Idle)
+			{
+				const auto size = getRingBufferSize(target);
+				const auto cur = static_cast<int>(engine.getRingBufferSizeF());
+				if (size > cur || size * ShrinkFactor <= cur)
+				{
+					requestedSize = size;
+					state.store(State::Requested);
+				}
+			}
+			else if (state.load() == State::Ready)
+			{
+				// a smaller ring is only adopted once the delays have glided into it
+				const auto& next = *engines[1 - active];
+				const auto nextSize = next.getRingBufferSizeF();
+				if (getRingBufferSize(target) > nextSize && nextSize < engine.getRingBufferSizeF())
+					state.store(State::Retired);
+				else if (timeSmooth.getValue() <= nextSize)
+				{
+					const auto limit = std::min(engine.getRingBufferSizeF(), nextSize);
+					warmup = static_cast<int>(limit) + Engine::TileSize + interpolation::MaxPoints;
+					fadePhase = static_cast<Float>(0);
+					state.store(State::Fading);
+				}
+			}
+
+			auto limit = engine.getRingBufferSizeF();
+			if (state.load() == State::Fading)
+				limit = std::min(limit, engines[1 - active]->getRingBufferSizeF());
+			constMaxTime = timeSmooth(timeBuf.data(), std::min(target, limit), numSamples);
+			return timeBuf.data();
+		}
+
+		// the last updateMaxTime returned one value throughout
+		bool isMaxTimeConst() const noexcept { return constMaxTime; }
+
+		void operator()(Float** samples, const UniBuf& uniBuf, Float gain,
+			int numPlanets, int numChannels, int numSamples,
+			Interpolation type = Interpolation::Hermite, workers::Pool* pool = nullptr, bool midSide = false) noexcept
+		{
+			if (state.load() != State::Fading)
+				return (*engines[active])(samples, uniBuf, gain, numPlanets, numChannels, numSamples, type, pool, midSide);
+
+			std::array<Float*, MaxChannels> next;
+			numChannels = std::min(numChannels, this->numChannels);
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				std::copy(samples[ch], samples[ch] + numSamples, fadeBuf[ch].data());
+				next[ch] = fadeBuf[ch].data();
+			}
+			(*engines[active])(samples, uniBuf, gain, numPlanets, numChannels, numSamples, type, pool, midSide);
+			(*engines[1 - active])(next.data(), uniBuf, gain, numPlanets, numChannels, numSamples, type, pool, midSide);
+
+			auto s0 = std::min(warmup, numSamples);
+			warmup -= s0;
+			for (auto s = s0; s < numSamples; ++s)
+			{
+				fadePhase = std::min(fadePhase + fadeInc, static_cast<Float>(1));
+				for (auto ch = 0; ch < numChannels; ++ch)
+					samples[ch][s] += fadePhase * (next[ch][s] - samples[ch][s]);
+			}
+
+			if (fadePhase == static_cast<Float>(1))
+			{
+				active = 1 - active;
+				state.store(State::Retired);
+			}
+		}
+
+		Float getRingBufferSizeF() const noexcept { return engines[active]->getRingBufferSizeF(); }
+		int getNumActiveTaps() const noexcept { return engines[active]->getNumActiveTaps(); }
+		// seconds after the input stopped until every planet is culled, as updateCulling counts them
+		Float getTailLengthSeconds() const noexcept
+		{
+			const auto tail = engines[active]->getRingSize() + Engine::FadeLength;
+			return static_cast<Float>(tail) / sampleRate;
+		}
+
+		void run() override
+		{
+			while (!threadShouldExit())
+			{
+				const auto s = state.load();
+				if (s == State::Requested)
+				{
+					auto engine = std::make_unique<Engine>();
+					engine->prepare(requestedSize, maxBlockSize, numChannels, sharedHistory, storageType);
+					engines[1 - active] = std::move(engine);
+					state.store(State::Ready);
+				}
+				else if (s == State::Retired)
+				{
+					engines[1 - active].reset();
+					state.store(State::Idle);
+				}
+				wait(AllocatorIntervalMs);
+			}
+		}
 	private:
-		WriteHead wHead;
-		DelayBuf delays;
+		std::array<EnginePtr, 2> engines;
+		std::atomic<State> state;
+		int requestedSize, active;
+		Smooth<Float> timeSmooth;
+		Buf timeBuf;
+		std::array<Buf, MaxChannels> fadeBuf;
+		Float sampleRate, fadeInc, fadePhase;
+		int warmup, maxBlockSize, numChannels;
+		bool sharedHistory, constMaxTime;
+		Storage storageType;
+
+		Float msToSamples(Float ms) const noexcept
+		{
+			return ms * sampleRate * static_cast<Float>(.001);
+		}
+
+		// the longest delay that fits into the power of two ring of numSamples
+		static int getRingBufferSize(Float numSamples) noexcept
+		{
+			static constexpr int Margin = Engine::TileSize + interpolation::MaxPoints;
+			const auto size = juce::nextPowerOfTwo(static_cast<int>(std::ceil(numSamples)) + Margin);
+			return size - Margin;
+		}
 	};
 }
\ No newline at end of file
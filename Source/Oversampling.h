@@ -0,0 +1,252 @@
+#pragma once
+#include <cmath>
+#include <array>
+#include <vector>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+/*
+* Polyphase half-band oversampling for the planet bus.
+* Each 2x stage is a linear-phase, Kaiser-windowed half-band FIR. Every other tap of a
+* half-band is zero, so one polyphase branch is a pure delay and only the other one,
+* Span taps long, is computed. The branch is evaluated as one multiply-add over the
+* whole block per tap, which FloatVectorOperations runs in SIMD.
+* Up- and downsampling round trips are padded at the top rate to a whole number of
+* base rate samples, so the latency can be reported to the host exactly.
+*/
+
+namespace oversampling
+{
+	static constexpr int MaxOrder = 2;
+	static constexpr int MaxChannels = 16;
+
+	/********** struct HalfBand **********/
+	template<typename Float, int NumCoefs>
+	struct HalfBand
+	{
+		static constexpr int NumTaps = 4 * NumCoefs - 1;
+		static constexpr int Centre = 2 * NumCoefs - 1; // group delay at the higher rate
+		static constexpr int Span = 2 * NumCoefs;
+
+		using Branch = std::array<Float, Span>;
+
+		// the non-trivial polyphase branch, normalised to unity gain at DC
+		static Branch makeBranch(double beta)
+		{
+			Branch branch;
+			auto sum = 0.;
+			for (auto q = 0; q < Span; ++q)
+			{
+				const auto m = 2 * q; // tap index, odd distance to the centre
+				const auto x = static_cast<double>(m - Centre);
+				const auto sinc = std::sin(.5 * 3.14159265359 * x) / (3.14159265359 * x);
+				const auto r = x / static_cast<double>(Centre);
+				const auto win = besselI0(beta * std::sqrt(1. - r * r)) / besselI0(beta);
+				branch[q] = static_cast<Float>(sinc * win);
+				sum += sinc * win;
+			}
+			for (auto& b : branch)
+				b = static_cast<Float>(static_cast<double>(b) / sum);
+			return branch;
+		}
+
+	private:
+		static double besselI0(double x) noexcept
+		{
+			auto sum = 1.;
+			auto term = 1.;
+			const auto xHalf = x * .5;
+			for (auto k = 1; k < 32; ++k)
+			{
+				term *= xHalf / static_cast<double>(k);
+				sum += term * term;
+			}
+			return sum;
+		}
+	};
+
+	/********** struct Stage **********/
+	/*
+	* One 2x stage of one channel.
+	* up: y[2n] = branch . x[n - Span + 1, n], y[2n + 1] = x[n - NumCoefs + 1]
+	* down: y[n] = .5 * (branch . e[n - Span + 1, n] + o[n - NumCoefs]), e/o = even/odd input samples
+	*/
+	template<typename Float, int NumCoefs>
+	struct Stage
+	{
+		using HB = HalfBand<Float, NumCoefs>;
+		static constexpr int Span = HB::Span;
+		static constexpr int Latency = 2 * HB::Centre; // up and down, in samples of the higher rate
+
+		using Buf = std::vector<Float>;
+
+		Stage() :
+			branch(),
+			upHist(), evenHist(), oddHist(),
+			phaseBuf()
+		{}
+
+		// numSamples: the most samples per block at the lower rate
+		void prepare(int numSamples, double beta)
+		{
+			branch = HB::makeBranch(beta);
+			upHist.assign(Span - 1 + numSamples, static_cast<Float>(0));
+			evenHist.assign(Span - 1 + numSamples, static_cast<Float>(0));
+			oddHist.assign(Span - 1 + numSamples, static_cast<Float>(0));
+			phaseBuf.assign(numSamples, static_cast<Float>(0));
+		}
+
+		// in: numSamples, out: 2 * numSamples
+		void up(const Float* in, Float* out, int numSamples) noexcept
+		{
+			auto hist = upHist.data();
+			std::copy(in, in + numSamples, hist + Span - 1);
+			convolve(hist, numSamples);
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				out[2 * s] = phaseBuf[s];
+				out[2 * s + 1] = hist[s + NumCoefs];
+			}
+			std::copy(hist + numSamples, hist + numSamples + Span - 1, hist);
+		}
+
+		// in: 2 * numSamples, out: numSamples
+		void down(const Float* in, Float* out, int numSamples) noexcept
+		{
+			auto even = evenHist.data();
+			auto odd = oddHist.data();
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				even[Span - 1 + s] = in[2 * s];
+				odd[Span - 1 + s] = in[2 * s + 1];
+			}
+			convolve(even, numSamples);
+			for (auto s = 0; s < numSamples; ++s)
+				out[s] = static_cast<Float>(.5) * (phaseBuf[s] + odd[s + NumCoefs - 1]);
+			std::copy(even + numSamples, even + numSamples + Span - 1, even);
+			std::copy(odd + numSamples, odd + numSamples + Span - 1, odd);
+		}
+
+	private:
+		typename HB::Branch branch;
+		Buf upHist, evenHist, oddHist, phaseBuf;
+
+		// phaseBuf[s] = branch . hist[s, s + Span), one block-wide multiply-add per tap
+		void convolve(const Float* hist, int numSamples) noexcept
+		{
+			auto dest = phaseBuf.data();
+			juce::FloatVectorOperations::multiply(dest, hist, branch[0], numSamples);
+			for (auto q = 1; q < Span; ++q)
+				juce::FloatVectorOperations::addWithMultiply(dest, hist + q, branch[q], numSamples);
+		}
+	};
+
+	/********** struct Oversampler **********/
+	/*
+	* order 0 = off, 1 = 2x, 2 = 4x.
+	* The first stage is sharp (63 taps, ~-80 dB), the second one only has to reject
+	* images above the first stage's passband (31 taps).
+	*/
+	template<typename Float>
+	struct Oversampler
+	{
+		using Stage1 = Stage<Float, 16>;
+		using Stage2 = Stage<Float, 8>;
+		using Buf = std::vector<Float>;
+		using Bufs = std::array<Buf, MaxChannels>;
+
+		Oversampler() :
+			stage1(), stage2(),
+			buf2x(), buf4x(),
+			padBuf(),
+			bufPtrs(),
+			order(0), latency(0), padLength(0), padIdx(0)
+		{}
+
+		// only the first numChannels channels are allocated
+		void prepare(int blockSize, int _order, int numChannels)
+		{
+			order = juce::jlimit(0, MaxOrder, _order);
+			const auto factor = getFactor();
+
+			auto latencyTop = 0;
+			if (order >= 1)
+				latencyTop += Stage1::Latency * (factor / 2);
+			if (order >= 2)
+				latencyTop += Stage2::Latency;
+			padLength = (factor - latencyTop % factor) % factor;
+			latency = (latencyTop + padLength) / factor;
+			padIdx = 0;
+
+			for (auto ch = 0; ch < MaxChannels; ++ch)
+			{
+				const auto used = ch < numChannels;
+				stage1[ch].prepare(used && order >= 1 ? blockSize : 0, 8.);
+				stage2[ch].prepare(used && order >= 2 ? blockSize * 2 : 0, 7.);
+				buf2x[ch].assign(used && order >= 1 ? blockSize * 2 : 0, static_cast<Float>(0));
+				buf4x[ch].assign(used && order >= 2 ? blockSize * 4 : 0, static_cast<Float>(0));
+				padBuf[ch].assign(used ? padLength : 0, static_cast<Float>(0));
+			}
+		}
+
+		// returns the upsampled channels, getFactor() * numSamples long
+		Float** upsample(const Float* const* samples, int numChannels, int numSamples) noexcept
+		{
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				stage1[ch].up(samples[ch], buf2x[ch].data(), numSamples);
+				bufPtrs[ch] = buf2x[ch].data();
+				if (order == 2)
+				{
+					stage2[ch].up(buf2x[ch].data(), buf4x[ch].data(), numSamples * 2);
+					bufPtrs[ch] = buf4x[ch].data();
+				}
+			}
+			return bufPtrs.data();
+		}
+
+		// reads the channels returned by upsample() back into samples
+		void downsample(Float** samples, int numChannels, int numSamples) noexcept
+		{
+			pad(numChannels, numSamples * getFactor());
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				if (order == 2)
+					stage2[ch].down(buf4x[ch].data(), buf2x[ch].data(), numSamples * 2);
+				stage1[ch].down(buf2x[ch].data(), samples[ch], numSamples);
+			}
+		}
+
+		int getOrder() const noexcept { return order; }
+		int getFactor() const noexcept { return 1 << order; }
+		// in samples of the base rate
+		int getLatency() const noexcept { return latency; }
+	private:
+		std::array<Stage1, MaxChannels> stage1;
+		std::array<Stage2, MaxChannels> stage2;
+		Bufs buf2x, buf4x, padBuf;
+		std::array<Float*, MaxChannels> bufPtrs;
+		int order, latency, padLength, padIdx;
+
+		// delays the top rate signal by padLength samples
+		void pad(int numChannels, int numSamples) noexcept
+		{
+			if (padLength == 0)
+				return;
+			auto idx = padIdx;
+			for (auto ch = 0; ch < numChannels; ++ch)
+			{
+				auto smpls = bufPtrs[ch];
+				auto ring = padBuf[ch].data();
+				idx = padIdx;
+				for (auto s = 0; s < numSamples; ++s)
+				{
+					const auto x = smpls[s];
+					smpls[s] = ring[idx];
+					ring[idx] = x;
+					idx = idx + 1 == padLength ? 0 : idx + 1;
+				}
+			}
+			padIdx = idx;
+		}
+	};
+}
@@ -1,6 +1,10 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <juce_core/juce_core.h>
 #include <juce_audio_processors/juce_audio_processors.h>
+#include "Interpolation.h"
 
 namespace param
 {
@@ -19,6 +23,8 @@ namespace param
 		Gravity,
 		SpaceMud,
 		Attraction,
+		Interpolation,
+		MaxTime,
 		NumParams
 	};
 
@@ -36,6 +42,8 @@ namespace param
 		case PID::Gravity: return "Gravity";
 		case PID::SpaceMud: return "Space Mud";
 		case PID::Attraction: return "Attraction";
+		case PID::Interpolation: return "Interpolation";
+		case PID::MaxTime: return "Max Time";
 		
 		default: return "";
 		}
@@ -63,9 +71,72 @@ namespace param
 	using ValToStrFunc = std::function<juce::String(float)>;
 	using StrToValFunc = std::function<float(const juce::String&)>;
 
+	/********** struct Range **********/
+	/*
+	* Maps a parameter between its normalised and denormalised value. The curve is
+	* picked by a tag instead of juce::NormalisableRange's std::function callbacks,
+	* so Param holds it by value and every conversion inlines into the caller.
+	*/
+	struct Range
+	{
+		enum class Curve { Linear, BiasXL, Stepped };
+
+		constexpr Range(Curve _curve, float _start, float _end, float _interval = 0.f,
+			float _a2 = 0.f, float _aM = 0.f, float _aR = 0.f) noexcept :
+			start(_start),
+			end(_end),
+			interval(_interval),
+			curve(_curve),
+			a2(_a2),
+			aM(_aM),
+			aR(_aR)
+		{}
+
+		constexpr float convertFrom0to1(float x) const noexcept
+		{
+			x = clamp0to1(x);
+			switch (curve)
+			{
+			case Curve::BiasXL: return start + aR * x / (aM - x + a2 * x);
+			default: return start + (end - start) * x;
+			}
+		}
+
+		constexpr float convertTo0to1(float v) const noexcept
+		{
+			switch (curve)
+			{
+			case Curve::BiasXL: return clamp0to1(aM * (v - start) / (a2 * start + aR - a2 * v - start + v));
+			case Curve::Stepped: return clamp0to1((v - start) * (1.f / (end - start)));
+			default: return clamp0to1((v - start) / (end - start));
+			}
+		}
+
+		float snapToLegalValue(float v) const noexcept
+		{
+			if (curve == Curve::Stepped)
+				return std::rint(v / interval) * interval;
+			if (interval > 0.f)
+				v = start + interval * std::floor((v - start) / interval + .5f);
+			return (v <= start || end <= start) ? start : (v >= end ? end : v);
+		}
+
+		float start, end, interval;
+	private:
+		Curve curve;
+		float a2, aM, aR;
+
+		static constexpr float clamp0to1(float x) noexcept { return x < 0.f ? 0.f : (x > 1.f ? 1.f : x); }
+	};
+
 	namespace makeRange
 	{
-		inline juce::NormalisableRange<float> biasXL(float start, float end, float bias) noexcept
+		constexpr Range linear(float start, float end) noexcept
+		{
+			return { Range::Curve::Linear, start, end };
+		}
+
+		constexpr Range biasXL(float start, float end, float bias) noexcept
 		{
 			// https://www.desmos.com/calculator/ps8q8gftcr
 			const auto a = bias * .5f + .5f;
@@ -74,45 +145,18 @@ namespace param
 			const auto r = end - start;
 			const auto aR = r * a;
 			if (bias != 0.f)
-				return
-			{
-					start, end,
-					[a2, aM, aR](float min, float, float x)
-					{
-						return min + aR * x / (aM - x + a2 * x);
-					},
-					[a2, aM, aR](float min, float, float x)
-					{
-						return aM * (x - min) / (a2 * min + aR - a2 * x - min + x);
-					},
-					nullptr
-			};
-			else return { start, end };
+				return { Range::Curve::BiasXL, start, end, 0.f, a2, aM, aR };
+			else return linear(start, end);
 		}
 
-		inline juce::NormalisableRange<float> toggle()
+		constexpr Range toggle() noexcept
 		{
-			return { 0.f, 1.f, 1.f };
+			return { Range::Curve::Linear, 0.f, 1.f, 1.f };
 		}
 
-		inline juce::NormalisableRange<float> stepped(float start, float end, float steps = 1.f)
+		constexpr Range stepped(float start, float end, float steps = 1.f) noexcept
 		{
-			return
-			{
-					start, end,
-					[range = end - start](float min, float, float normalized)
-					{
-						return min + normalized * range;
-					},
-					[rangeInv = 1.f / (end - start)](float min, float, float denormalized)
-					{
-						return (denormalized - min) * rangeInv;
-					},
-					[steps, stepsInv = 1.f / steps](float, float, float val)
-					{
-						return std::rint(val * stepsInv) * steps;
-					}
-			};
+			return { Range::Curve::Stepped, start, end, steps };
 		}
 	}
 
@@ -125,10 +169,118 @@ namespace param
 		juce::Identifier value{ "value" };
 	};
 
+	/********** struct Event **********/
+	struct Event
+	{
+		juce::int64 ticks;
+		float valNorm;
+		int idx;
+		// pushed after the last block ended, i.e. by the host right before the block it belongs to
+		bool sync;
+	};
+
+	/********** struct EventQueue **********/
+	/*
+	* Bounded lock-free queue of parameter changes. Any thread may push, only the
+	* audio thread pops. Every cell has a sequence number that tells whether it
+	* is free for the next push or holds the next pop's event.
+	* markBlockEnd remembers the write position at the end of a block, so pop can tell
+	* the events pushed between two blocks from the ones pushed while one ran,
+	* whichever threads the host processes and automates on.
+	*/
+	struct EventQueue
+	{
+		static constexpr int Size = 1 << 10;
+		static constexpr std::uint32_t Mask = Size - 1;
+
+		EventQueue() :
+			cells(),
+			writeIdx(0),
+			readIdx(0),
+			blockEnd(0),
+			overflowed(false)
+		{
+			for (auto i = 0; i < Size; ++i)
+				cells[i].seq.store(static_cast<std::uint32_t>(i), std::memory_order_relaxed);
+		}
+
+		// any thread. drops the event and remembers that it did when the queue is full
+		void push(int idx, float valNorm) noexcept
+		{
+			const Event event
+			{
+				juce::Time::getHighResolutionTicks(),
+				valNorm,
+				idx,
+				false
+			};
+
+			auto pos = writeIdx.load(std::memory_order_relaxed);
+			while (true)
+			{
+				auto& cell = cells[pos & Mask];
+				const auto seq = cell.seq.load(std::memory_order_acquire);
+				const auto dif = static_cast<std::int32_t>(seq - pos);
+				if (dif == 0)
+				{
+					if (writeIdx.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					{
+						cell.event = event;
+						cell.seq.store(pos + 1, std::memory_order_release);
+						return;
+					}
+				}
+				else if (dif < 0)
+				{
+					overflowed.store(true, std::memory_order_relaxed);
+					return;
+				}
+				else
+					pos = writeIdx.load(std::memory_order_relaxed);
+			}
+		}
+
+		// audio thread
+		bool pop(Event& event) noexcept
+		{
+			auto& cell = cells[readIdx & Mask];
+			if (cell.seq.load(std::memory_order_acquire) != readIdx + 1)
+				return false;
+			event = cell.event;
+			event.sync = static_cast<std::int32_t>(readIdx - blockEnd) >= 0;
+			cell.seq.store(readIdx + Size, std::memory_order_release);
+			++readIdx;
+			return true;
+		}
+
+		// audio thread. returns true if events were dropped since the last call
+		bool resetOverflow() noexcept
+		{
+			return overflowed.exchange(false, std::memory_order_relaxed);
+		}
+
+		// audio thread, at the end of each block. later pushes belong to the start of the next one
+		void markBlockEnd() noexcept
+		{
+			blockEnd = writeIdx.load(std::memory_order_acquire);
+		}
+	private:
+		struct Cell
+		{
+			std::atomic<std::uint32_t> seq;
+			Event event;
+		};
+
+		std::array<Cell, Size> cells;
+		std::atomic<std::uint32_t> writeIdx;
+		std::uint32_t readIdx, blockEnd;
+		std::atomic<bool> overflowed;
+	};
+
 	struct Param :
 		public juce::AudioProcessorParameter
 	{
-		Param(const PID pID, const juce::NormalisableRange<float>& _range, const float _valDenormDefault,
+		Param(const PID pID, const Range& _range, const float _valDenormDefault,
 			const ValToStrFunc& _valToStr, const StrToValFunc& _strToVal,
 			const Unit _unit = Unit::NumUnits) :
 
@@ -139,7 +291,8 @@ namespace param
 			valNorm(range.convertTo0to1(_valDenormDefault)),
 			valToStr(_valToStr),
 			strToVal(_strToVal),
-			unit(_unit)
+			unit(_unit),
+			events(nullptr)
 		{
 		}
 
@@ -152,7 +305,11 @@ namespace param
 		void setValue(float normalized) override
 		{
 			valNorm.store(normalized);
+			if (events != nullptr)
+				events->push(static_cast<int>(id), normalized);
 		}
+		// every change is pushed to the queue, so the audio thread knows when it happened
+		void setEventQueue(EventQueue* queue) noexcept { events = queue; }
 		void setValueWithGesture(float norm)
 		{
 			beginChangeGesture();
@@ -195,13 +352,14 @@ namespace param
 		}
 
 		const PID id;
-		const juce::NormalisableRange<float> range;
+		const Range range;
 	protected:
 		const float valDenormDefault;
 		std::atomic<float> valNorm;
 		ValToStrFunc valToStr;
 		StrToValFunc strToVal;
 		Unit unit;
+		EventQueue* events;
 
 		JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Param)
 	};
@@ -209,7 +367,8 @@ namespace param
 	struct Params
 	{
 		Params(juce::AudioProcessor& audioProcessor) :
-			params()
+			params(),
+			events()
 		{
 			const auto strToValDivision = [](const juce::String& txt, const float altVal)
 			{
@@ -249,6 +408,10 @@ namespace param
 			const auto valToStrPlanets = [](float v) { return juce::String(v).substring(0, 2); };
 			const auto valToStrGravity = [](float v) { return juce::String(v).substring(0, 5) + " G"; };
 			const auto valToStrEmpty = [](float) { return juce::String(""); };
+			const auto valToStrInterpolation = [](float v)
+			{
+				return orbit::interpolation::toString(static_cast<orbit::interpolation::Type>(static_cast<int>(v + .5f)));
+			};
 
 			const auto strToValPercent = [strToValDivision](const juce::String& txt)
 			{
@@ -277,6 +440,13 @@ namespace param
 			const auto strToValDb = [](const juce::String& txt) { return txt.trimCharactersAtEnd(toString(Unit::Decibel)).getFloatValue(); };
 			const auto strToValPlanets = [](const juce::String& txt) { return std::floor(txt.getFloatValue()); };
 			const auto strToValGravity = [](const juce::String& txt) { return std::floor(txt.getFloatValue()); };
+			const auto strToValInterpolation = [](const juce::String& txt)
+			{
+				for (auto i = 0; i < orbit::interpolation::NumTypes; ++i)
+					if (txt.trim().toLowerCase() == orbit::interpolation::toString(static_cast<orbit::interpolation::Type>(i)))
+						return static_cast<float>(i);
+				return std::floor(txt.getFloatValue());
+			};
 
 			params.push_back(new Param(PID::Depth, makeRange::biasXL(.02f, 1.f, 0.f), 1.f, valToStrPercent, strToValPercent));
 			params.push_back(new Param(PID::Mix, makeRange::biasXL(0.f, 1.f, 0.f), 1.f, valToStrRatio, strToValRatio));
@@ -287,9 +457,15 @@ namespace param
 			params.push_back(new Param(PID::Gravity, makeRange::biasXL(.001f, 1.f, -.95f), .001f, valToStrGravity, strToValGravity));
 			params.push_back(new Param(PID::SpaceMud, makeRange::biasXL(0.f, .5f, -.9f), 0.f, valToStrPercent, strToValPercent));
 			params.push_back(new Param(PID::Attraction, makeRange::biasXL(-1.f, 1.f, 0.f), 1.f, valToStrPercent, strToValPercent));
+			params.push_back(new Param(PID::Interpolation, makeRange::stepped(0.f, static_cast<float>(orbit::interpolation::NumTypes - 1), 1.f),
+				static_cast<float>(orbit::interpolation::Type::Hermite), valToStrInterpolation, strToValInterpolation));
+			params.push_back(new Param(PID::MaxTime, makeRange::biasXL(1.f, 2000.f, -.9f), 40.f, valToStrMs, strToValMs));
 
 			for (auto param : params)
+			{
+				param->setEventQueue(&events);
 				audioProcessor.addParameter(param);
+			}
 		}
 
 		void loadPatch(juce::ValueTree& state)
@@ -357,7 +533,170 @@ namespace param
 		const Param& operator[](int i) const noexcept { return *params[i]; }
 		Param& operator[](PID pID) noexcept { return operator[](static_cast<int>(pID)); }
 		const Param& operator[](PID pID) const noexcept { return operator[](static_cast<int>(pID)); }
+
+		EventQueue& getEvents() noexcept { return events; }
 	protected:
 		std::vector<Param*> params;
+		EventQueue events;
+	};
+
+	/********** struct Snapshot **********/
+	/*
+	* All parameters as the audio thread sees them. A parameter is only denormalised
+	* again when it changed, the dirty bits tell which ones did since clearChanges.
+	*/
+	struct Snapshot
+	{
+		static_assert(NumParams <= 32, "one dirty bit per parameter");
+
+		Snapshot() :
+			valNorm(),
+			valDenorm(),
+			dirty(0)
+		{
+			invalidate();
+			valDenorm.fill(0.f);
+		}
+
+		// the next update marks every parameter as changed
+		void invalidate() noexcept { valNorm.fill(-1.f); }
+
+		// reads every parameter. returns true if any of them changed
+		bool update(const Params& params) noexcept
+		{
+			const auto dirtyBefore = dirty;
+			for (auto p = 0; p < NumParams; ++p)
+				set(params, p, params[p].getValue());
+			return dirty != dirtyBefore;
+		}
+
+		void set(const Params& params, int idx, float val) noexcept
+		{
+			if (val == valNorm[idx])
+				return;
+			valNorm[idx] = val;
+			valDenorm[idx] = params[idx].range.convertFrom0to1(val);
+			dirty |= 1u << idx;
+		}
+
+		// call once the changes were processed
+		void clearChanges() noexcept { dirty = 0; }
+
+		float getValue(PID pID) const noexcept { return valNorm[static_cast<int>(pID)]; }
+		float getValDenorm(PID pID) const noexcept { return valDenorm[static_cast<int>(pID)]; }
+		// the parameter changed since the last clearChanges
+		bool changed(PID pID) const noexcept { return ((dirty >> static_cast<int>(pID)) & 1u) != 0; }
+	private:
+		std::array<float, NumParams> valNorm, valDenorm;
+		std::uint32_t dirty;
+	};
+
+	/********** struct Automation **********/
+	/*
+	* Schedules the parameter changes of the event queue at sample offsets of a block.
+	* Changes that came in between two blocks belong to the start of the next block,
+	* that's where the host sets a block's automation, on whichever thread.
+	* Changes made while a block ran (editor, host automation from its UI thread)
+	* keep their relative timing: they are placed at the point of the block that
+	* matches when they happened during the last block period, which delays them by
+	* one period instead of quantising them to block boundaries.
+	* Offsets snap to Grid samples, so a fast gesture can't break a block into tiny pieces.
+	*/
+	struct Automation
+	{
+		static constexpr int Grid = 16;
+
+		Automation() :
+			events(),
+			numEvents(0),
+			next(0),
+			lastTicks(0),
+			sampleRate(44100.)
+		{}
+
+		void prepare(double _sampleRate) noexcept
+		{
+			sampleRate = _sampleRate;
+			lastTicks = 0;
+			numEvents = next = 0;
+		}
+
+		/*
+		* audio thread, once per block. returns false if changes were dropped
+		* or came before the first block. read every parameter once then
+		*/
+		bool beginBlock(EventQueue& queue, int numSamples) noexcept
+		{
+			const auto now = juce::Time::getHighResolutionTicks();
+			const auto period = now - lastTicks;
+			const auto maxPeriod = static_cast<juce::int64>(2. * numSamples / sampleRate
+				* static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()));
+			// timing is meaningless after the host paused processing
+			const auto timed = lastTicks != 0 && period > 0 && period <= maxPeriod;
+			auto complete = !queue.resetOverflow() && lastTicks != 0;
+			lastTicks = now;
+
+			numEvents = next = 0;
+			auto numAtStart = 0;
+			auto offset = 0;
+			Event event;
+			while (queue.pop(event))
+			{
+				if (numEvents == EventQueue::Size)
+				{
+					complete = false;
+					continue;
+				}
+				if (event.sync)
+				{
+					// after the changes already at the start, before the ones scheduled later
+					for (auto i = numEvents; i > numAtStart; --i)
+						events[i] = events[i - 1];
+					events[numAtStart] = { 0, event.valNorm, event.idx };
+					++numAtStart;
+					++numEvents;
+					continue;
+				}
+				if (timed)
+				{
+					const auto o = static_cast<int>((event.ticks - (now - period)) * numSamples / period);
+					offset = std::max(offset, juce::jlimit(0, numSamples - 1, o) & ~(Grid - 1));
+				}
+				if (offset == 0)
+					++numAtStart;
+				events[numEvents] = { offset, event.valNorm, event.idx };
+				++numEvents;
+			}
+
+			if (!complete)
+				numEvents = 0;
+			return complete;
+		}
+
+		// audio thread, once the block is processed
+		void endBlock(EventQueue& queue) noexcept
+		{
+			queue.markBlockEnd();
+		}
+
+		// applies the changes due at sample s. returns the offset of the next one or numSamples
+		int apply(Snapshot& snapshot, const Params& params, int s, int numSamples) noexcept
+		{
+			for (; next < numEvents && events[next].offset <= s; ++next)
+				snapshot.set(params, events[next].idx, events[next].valNorm);
+			return next < numEvents ? events[next].offset : numSamples;
+		}
+	private:
+		struct Scheduled
+		{
+			int offset;
+			float valNorm;
+			int idx;
+		};
+
+		std::array<Scheduled, EventQueue::Size> events;
+		int numEvents, next;
+		juce::int64 lastTicks;
+		double sampleRate;
 	};
 }
\ No newline at end of file
@@ -18,7 +18,7 @@ public:
     void resized() override;
 
     NELOrbitAudioProcessor& audioProcessor;
-    orbit::gui::Editor<float, NumPlanetsMacro, 30> orbit;
+    orbit::gui::Editor<NELOrbitAudioProcessor::PhysicsFloat, NumPlanetsMacro, 30> orbit;
     orbit::gui::Utils utils;
     orbit::gui::UI ui;
 };
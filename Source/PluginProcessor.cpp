@@ -15,11 +15,16 @@ NELOrbitAudioProcessor::NELOrbitAudioProcessor()
     state("state"),
     params(*this),
     
-    dryWet(),
     orbit(11),
-    universalBuffer(),
-    audioBufs(),
-    delays()
+    chainFloat(),
+    chainDouble(),
+    workerPool(),
+    snapshot(),
+    automation(),
+    tailLength(0.)
+#if TraceMacro
+    , traceRecorder()
+#endif
 #endif
 {
     {
@@ -67,7 +72,7 @@ bool NELOrbitAudioProcessor::isMidiEffect() const
 
 double NELOrbitAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.;
+    return tailLength.load(std::memory_order_relaxed);
 }
 
 int NELOrbitAudioProcessor::getNumPrograms()
@@ -93,35 +98,118 @@ void NELOrbitAudioProcessor::changeProgramName (int, const juce::String&)
 {
 }
 
-void NELOrbitAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
+void NELOrbitAudioProcessor::prepareToPlay(double sampleRate, int)
+{
+    const auto& user = *props.getUserSettings();
+    // process-wide. the first prepared instance decides
+    simd::select(static_cast<simd::Isa>(user.getIntValue("simd", simd::NumIsas - 1)));
+    workerPool.prepare(user.getIntValue("workerThreads", 1));
+    snapshot.invalidate();
+    automation.prepare(sampleRate);
+    const auto numChannels = juce::jlimit(1, MaxChannels, getTotalNumOutputChannels());
+
+    if (isUsingDoublePrecision())
+    {
+        chainFloat.delays.release();
+        prepareChain(chainDouble, sampleRate, numChannels);
+    }
+    else
+    {
+        chainDouble.delays.release();
+        prepareChain(chainFloat, sampleRate, numChannels);
+    }
+}
+
+template<typename Sample>
+void NELOrbitAudioProcessor::prepareChain(AudioChain<Sample>& chain, double sampleRate, int numChannels)
+{
+    const auto& user = *props.getUserSettings();
+    auto& oversampler = chain.oversampler;
+    const auto order = juce::jlimit(0, oversampling::MaxOrder, user.getIntValue("oversampling", 0));
+    const auto blockSize = SubBlockSize >> order;
+    oversampler.prepare(blockSize, order, numChannels);
+    const auto factor = oversampler.getFactor();
+    const auto sampleRateUp = sampleRate * factor;
+    const auto blockSizeUp = blockSize * factor;
+    setLatencySamples(oversampler.getLatency());
+
+    orbit.prepare(static_cast<PhysicsFloat>(sampleRateUp), blockSizeUp, oversampler.getOrder());
+    chain.universalBuffer.prepare(static_cast<Sample>(sampleRateUp), blockSizeUp);
+    const auto sharedHistory = user.getBoolValue("sharedHistory", false);
+    const auto ringStorage = juce::jlimit(0, orbit::storage::NumTypes - 1, user.getIntValue("ringStorage", 0));
+    chain.delays.prepare
+    (
+        static_cast<Sample>(sampleRateUp),
+        blockSizeUp,
+        numChannels,
+        static_cast<Sample>(params[param::PID::MaxTime].getValDenorm()),
+        sharedHistory,
+        static_cast<orbit::storage::Type>(ringStorage)
+    );
+    chain.dryWet.prepare(static_cast<Sample>(sampleRate), blockSize, numChannels, oversampler.getLatency());
+    chain.bypass.prepare(static_cast<Sample>(sampleRate), blockSize);
+    updateTailLength(chain);
+#if TraceMacro
+    traceRecorder.prepare(sampleRateUp, blockSizeUp);
+#endif
+}
+
+template<typename Sample>
+void NELOrbitAudioProcessor::updateTailLength(const AudioChain<Sample>& chain) noexcept
 {
-    const auto sampleRateF = static_cast<float>(sampleRate);
-    orbit.prepare(sampleRateF, samplesPerBlock);
-    universalBuffer.prepare(sampleRateF, samplesPerBlock);
-    delays.prepare(sampleRateF, samplesPerBlock);
-    for (auto& b : audioBufs)
-        for(auto& ch: b)
-            ch.resize(samplesPerBlock, 0);
-    dryWet.prepare(sampleRateF, samplesPerBlock);
+    // the delays count at the planets' rate, the dry signal's latency at the host's
+    const auto latency = static_cast<double>(chain.oversampler.getLatency()) / getSampleRate();
+    tailLength.store(static_cast<double>(chain.delays.getTailLengthSeconds()) + latency, std::memory_order_relaxed);
 }
 
 void NELOrbitAudioProcessor::releaseResources()
 {
+    chainFloat.delays.stopThread(1000);
+    chainDouble.delays.stopThread(1000);
+    workerPool.release();
+#if TraceMacro
+    traceRecorder.stop();
+#endif
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool NELOrbitAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
 {
-    const auto mono = juce::AudioChannelSet::mono();
-    const auto stereo = juce::AudioChannelSet::stereo();
+    // any layout up to MaxChannels, e.g. 5.1, 7.1 or ambisonics, as long as input and output match
     const auto mainOut = layouts.getMainOutputChannelSet();
     const auto mainIn = layouts.getMainInputChannelSet();
 
-    return (mainOut == mono || mainOut == stereo) && (mainOut == mainIn);
+    return !mainOut.isDisabled() && mainOut.size() <= MaxChannels && (mainOut == mainIn);
 }
 #endif
 
+bool NELOrbitAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
 void NELOrbitAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    processBuffer(chainFloat, buffer, false);
+}
+
+void NELOrbitAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer&)
+{
+    processBuffer(chainDouble, buffer, false);
+}
+
+void NELOrbitAudioProcessor::processBlockBypassed(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    processBuffer(chainFloat, buffer, true);
+}
+
+void NELOrbitAudioProcessor::processBlockBypassed(juce::AudioBuffer<double>& buffer, juce::MidiBuffer&)
+{
+    processBuffer(chainDouble, buffer, true);
+}
+
+template<typename Sample>
+void NELOrbitAudioProcessor::processBuffer(AudioChain<Sample>& chain, juce::AudioBuffer<Sample>& buffer, bool bypassed) noexcept
 {
     juce::ScopedNoDenormals noDenormals;
     const auto totalNumInputChannels  = getTotalNumInputChannels();
@@ -131,100 +219,186 @@ void NELOrbitAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce
         buffer.clear (i, 0, numSamples);
 
     const auto numChannelsIn = getChannelCountOfBus(true, 0);
-    const auto numChannels = buffer.getNumChannels();
-    const auto samplesDry = const_cast<float const**>(buffer.getArrayOfReadPointers());
-    auto samples = const_cast<float **>(buffer.getArrayOfWritePointers());
+    const auto numChannels = std::min(buffer.getNumChannels(), MaxChannels);
+    auto samples = buffer.getArrayOfWritePointers();
 
-    dryWet.saveDry
+    if (!automation.beginBlock(params.getEvents(), numSamples))
+        snapshot.update(params);
+
+    // everything is prepared for sub-blocks of SubBlockSize samples at the planets' rate.
+    // they are cut short where a parameter changes
+    const auto subBlockSize = SubBlockSize >> chain.oversampler.getOrder();
+    std::array<Sample*, MaxChannels> subBlock;
+    for (auto s = 0; s < numSamples;)
+    {
+        const auto nextChange = automation.apply(snapshot, params, s, numSamples);
+        const auto n = std::min(subBlockSize, nextChange - s);
+        for (auto ch = 0; ch < numChannels; ++ch)
+            subBlock[ch] = samples[ch] + s;
+
+        const auto rangOut = chain.delays.getNumActiveTaps() == 0;
+        const auto fade = chain.bypass(bypassed, rangOut, n);
+        if (chain.bypass.isAsleep())
+            chain.dryWet.bypass(subBlock.data(), numChannelsIn, numChannels, n);
+        else if (fade == nullptr && rangOut && isSilent(subBlock.data(), numChannelsIn, n))
+            processSilence(chain, subBlock.data(), numChannelsIn, numChannels, n);
+        else
+            processSubBlock(chain, subBlock.data(), numChannelsIn, numChannels, n, fade);
+        s += n;
+    }
+
+    automation.endBlock(params.getEvents());
+    updateTailLength(chain);
+}
+
+template<typename Sample>
+void NELOrbitAudioProcessor::processSubBlock(AudioChain<Sample>& chain, Sample** samples,
+    int numChannelsIn, int numChannels, int numSamples, const Sample* fade) noexcept
+{
+    const auto samplesDry = const_cast<Sample const**>(samples);
+
+    chain.dryWet.saveDry
     (
         samplesDry,
-        params[param::PID::Mix].getValue(),
+        static_cast<Sample>(snapshot.getValue(param::PID::Mix)),
         numChannelsIn,
         numChannels,
-        numSamples
+        numSamples,
+        fade
     );
 
-    if (numChannels == 2 && params[param::PID::StereoConfig].getValue() > .5f)
-    {
-        midSide::encode(samples, numSamples);
-        processBlock(samples, numChannels, numSamples);
-        midSide::decode(samples, numSamples);
-    }
-    else
-        processBlock(samples, numChannels, numSamples);
+    // while the bypass fades the planets only hear the faded input
+    if (fade != nullptr)
+        for (auto ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::multiply(samples[ch], fade, numSamples);
+
+    // the delays code a stereo input to mid/side and back as they write and mix it
+    const auto midSide = numChannels == 2 && snapshot.getValue(param::PID::StereoConfig) > .5f;
+    processBlock(chain, samples, numChannels, numSamples, midSide);
 
-    dryWet.processWet
+    chain.dryWet.processWet
     (
         samples,
-        params[param::PID::Gain].getValDenorm(),
+        snapshot.getValDenorm(param::PID::Gain),
+        numChannelsIn,
+        numChannels,
+        numSamples,
+        fade
+    );
+    snapshot.clearChanges();
+}
+
+/*
+* the delays rang out and the input is silent, so the wet signal would be too. only the
+* planets move on, so they are where they'd be once the input returns. the delays and the
+* modulation sleep until then, their state only holds silence. the dry/wet stage keeps
+* running, its latency ring still holds the input from before the silence
+*/
+template<typename Sample>
+void NELOrbitAudioProcessor::processSilence(AudioChain<Sample>& chain, Sample** samples,
+    int numChannelsIn, int numChannels, int numSamples) noexcept
+{
+    chain.dryWet.processSilence
+    (
+        samples,
+        static_cast<Sample>(snapshot.getValue(param::PID::Mix)),
+        snapshot.getValDenorm(param::PID::Gain),
         numChannelsIn,
         numChannels,
         numSamples
     );
-    
+
+    chain.slept = true;
+    orbit.advance
+    (
+        numSamples * chain.oversampler.getFactor(),
+        static_cast<int>(snapshot.getValDenorm(param::PID::NumPlanets) + .5f),
+        snapshot.getValDenorm(param::PID::Gravity),
+        1.f - snapshot.getValDenorm(param::PID::SpaceMud) * .01f,
+        snapshot.getValDenorm(param::PID::Attraction) * .01f
+    );
 }
 
-void NELOrbitAudioProcessor::processBlock(float** samples, int numChannels, int numSamples) noexcept
+template<typename Sample>
+void NELOrbitAudioProcessor::processBlock(AudioChain<Sample>& chain, Sample** samples, int numChannels, int numSamples,
+    bool midSide) noexcept
 {
-    for (auto& audioBuf : audioBufs)
-        for (auto ch = 0; ch < numChannels; ++ch)
-        {
-            auto buf = audioBuf[ch].data();
-            for (auto s = 0; s < numSamples; ++s)
-                buf[s] = samples[ch][s];
-        }
+    auto& oversampler = chain.oversampler;
+    if (oversampler.getOrder() == 0)
+        return processPlanets(chain, samples, numChannels, numSamples, midSide);
+
+    const auto samplesUp = oversampler.upsample(samples, numChannels, numSamples);
+    processPlanets(chain, samplesUp, numChannels, numSamples * oversampler.getFactor(), midSide);
+    oversampler.downsample(samples, numChannels, numSamples);
+}
 
-    const auto numPlanets = static_cast<int>(params[param::PID::NumPlanets].getValDenorm() + .5f);
+template<typename Sample>
+void NELOrbitAudioProcessor::processPlanets(AudioChain<Sample>& chain, Sample** samples, int numChannels, int numSamples,
+    bool midSide) noexcept
+{
+    auto& universalBuffer = chain.universalBuffer;
+    auto& delays = chain.delays;
+    const auto numPlanets = static_cast<int>(snapshot.getValDenorm(param::PID::NumPlanets) + .5f);
 
     orbit.processBlock
     (
         universalBuffer,
         numSamples,
         numPlanets,
-        params[param::PID::Gravity].getValDenorm(),
-        1.f - params[param::PID::SpaceMud].getValDenorm() * .01f,
-        params[param::PID::Attraction].getValDenorm() * .01f
+        snapshot.getValDenorm(param::PID::Gravity),
+        1.f - snapshot.getValDenorm(param::PID::SpaceMud) * .01f,
+        snapshot.getValDenorm(param::PID::Attraction) * .01f
     );
+    if (chain.slept)
+    {
+        universalBuffer.settle(numPlanets);
+        chain.slept = false;
+    }
+
+    const auto maxTime = delays.updateMaxTime(static_cast<Sample>(snapshot.getValDenorm(param::PID::MaxTime)), numSamples);
 
+    // settled Max Time and Depth select the modulation's constant span variant
     universalBuffer.makeSmooth
     (
-        delays.getRingBufferSizeF(),
-        params[param::PID::Depth].getValue(),
+        maxTime,
+        static_cast<Sample>(snapshot.getValue(param::PID::Depth)),
         numSamples,
-        numPlanets
+        numPlanets,
+        delays.isMaxTimeConst()
     );
 
+    if (snapshot.changed(param::PID::NumPlanets))
+        chain.planetsGain = static_cast<Sample>(1) / std::sqrt(static_cast<Sample>(numPlanets));
+    const auto interpolation = static_cast<orbit::interpolation::Type>(static_cast<int>(snapshot.getValDenorm(param::PID::Interpolation) + .5f));
+
     delays
     (
-        audioBufs,
+        samples,
         universalBuffer,
+        chain.planetsGain,
         numPlanets,
         numChannels,
-        numSamples
+        numSamples,
+        interpolation,
+        &workerPool,
+        midSide
     );
 
-    {
-        const auto& audioBuf = audioBufs[0];
-        for (auto ch = 0; ch < numChannels; ++ch)
-        {
-            const auto buf = audioBuf[ch].data();
-            for (auto s = 0; s < numSamples; ++s)
-                samples[ch][s] = buf[s];
-        }
-    }
-    for (auto i = 1; i < numPlanets; ++i)
-    {
-        const auto& audioBuf = audioBufs[i];
-        for (auto ch = 0; ch < numChannels; ++ch)
-        {
-            const auto buf = audioBuf[ch].data();
-            for (auto s = 0; s < numSamples; ++s)
-                samples[ch][s] += buf[s];
-        }
-    }
-    const auto planetsGain = 1.f / std::sqrt(static_cast<float>(numPlanets));
+#if TraceMacro
+    traceRecorder.push(universalBuffer, numPlanets, numSamples, delays.getNumActiveTaps());
+#endif
+}
+
+// below the delays' culling threshold, i.e. the planets wouldn't hear it
+template<typename Sample>
+bool NELOrbitAudioProcessor::isSilent(const Sample* const* samples, int numChannels, int numSamples) noexcept
+{
+    static constexpr auto Threshold = AudioChain<Sample>::Delays::Engine::CullThreshold;
     for (auto ch = 0; ch < numChannels; ++ch)
-        juce::FloatVectorOperations::multiply(samples[ch], planetsGain, numSamples);
+        for (auto s = 0; s < numSamples; ++s)
+            if (std::abs(samples[ch][s]) > Threshold)
+                return false;
+    return true;
 }
 
 bool NELOrbitAudioProcessor::hasEditor() const
@@ -1,10 +1,17 @@
 #pragma once
 #include "Param.h"
 #include "Orbit.h"
-#include "MidSideEncoder.h"
 #include "DryWetProcessor.h"
+#include "Oversampling.h"
+#include "Bypass.h"
+#include "Trace.h"
 #include <JuceHeader.h>
 
+// 1 runs the planets' physics in double precision. the audio runs at the host's precision either way
+#ifndef DoublePhysicsMacro
+#define DoublePhysicsMacro 0
+#endif
+
 struct NELOrbitAudioProcessor :
     public juce::AudioProcessor
 {
@@ -23,7 +30,10 @@ struct NELOrbitAudioProcessor :
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-    void processBlock (float** samples, int numChannels, int numSamples) noexcept;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -48,21 +58,82 @@ struct NELOrbitAudioProcessor :
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    // the most samples the chain processes at once, at the planets' (oversampled) rate
+    static constexpr int SubBlockSize = 128;
+    static constexpr int MaxChannels = orbit::MaxChannels;
+
     using DryBuf = std::array<std::vector<float>, 2>;
     using ParamBuf = std::vector<float>;
     using ParamSmooth = orbit::Smooth<float>;
 
-    using Orbit = orbit::Processor<float, NumPlanetsMacro>;
-    using UniversalBuffer = orbit::UniversalBuffer<float, NumPlanetsMacro>;
-    using AudioBufs = std::array<std::array<std::vector<float>, 2>, NumPlanetsMacro>;
-    using Delays = orbit::Delays<float, NumPlanetsMacro>;
+    using PhysicsFloat = std::conditional<DoublePhysicsMacro != 0, double, float>::type;
+    using Orbit = orbit::Processor<PhysicsFloat, NumPlanetsMacro>;
+    using WorkerPool = workers::Pool;
+#if TraceMacro
+    using TraceRecorder = trace::Recorder<NumPlanetsMacro>;
+#endif
+
+    // everything that runs at the host's sample precision. only the one in use is prepared
+    template<typename Sample>
+    struct AudioChain
+    {
+        using DryWet = drywet::Processor<Sample>;
+        using UniversalBuffer = orbit::UniversalBuffer<Sample, NumPlanetsMacro>;
+        using Delays = orbit::ResizingMultiTap<Sample, NumPlanetsMacro>;
+        using Oversampler = oversampling::Oversampler<Sample>;
+        using Bypass = bypass::Processor<Sample>;
+
+        AudioChain() :
+            dryWet(),
+            universalBuffer(),
+            delays(),
+            oversampler(),
+            bypass(),
+            planetsGain(static_cast<Sample>(1)),
+            slept(false)
+        {}
+
+        DryWet dryWet;
+        UniversalBuffer universalBuffer;
+        Delays delays;
+        Oversampler oversampler;
+        Bypass bypass;
+        Sample planetsGain;
+        // the planets moved on without the modulation
+        bool slept;
+    };
 
     AppProps props;
     juce::ValueTree state;
     param::Params params;
-    drywet::Processor dryWet;
     Orbit orbit;
-    UniversalBuffer universalBuffer;
-    AudioBufs audioBufs;
-    Delays delays;
+    AudioChain<float> chainFloat;
+    AudioChain<double> chainDouble;
+    WorkerPool workerPool;
+    param::Snapshot snapshot;
+    param::Automation automation;
+    std::atomic<double> tailLength;
+#if TraceMacro
+    TraceRecorder traceRecorder;
+#endif
+
+private:
+    template<typename Sample>
+    void prepareChain (AudioChain<Sample>& chain, double sampleRate, int numChannels);
+    template<typename Sample>
+    void updateTailLength (const AudioChain<Sample>& chain) noexcept;
+    template<typename Sample>
+    void processBuffer (AudioChain<Sample>& chain, juce::AudioBuffer<Sample>& buffer, bool bypassed) noexcept;
+    template<typename Sample>
+    void processSubBlock (AudioChain<Sample>& chain, Sample** samples, int numChannelsIn, int numChannels, int numSamples,
+        const Sample* fade) noexcept;
+    template<typename Sample>
+    void processSilence (AudioChain<Sample>& chain, Sample** samples, int numChannelsIn, int numChannels,
+        int numSamples) noexcept;
+    template<typename Sample>
+    void processBlock (AudioChain<Sample>& chain, Sample** samples, int numChannels, int numSamples, bool midSide) noexcept;
+    template<typename Sample>
+    void processPlanets (AudioChain<Sample>& chain, Sample** samples, int numChannels, int numSamples, bool midSide) noexcept;
+    template<typename Sample>
+    static bool isSilent (const Sample* const* samples, int numChannels, int numSamples) noexcept;
 };
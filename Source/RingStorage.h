@@ -0,0 +1,141 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#if defined(__F16C__) || defined(__AVX2__)
+#include <immintrin.h>
+#define ORBIT_HAS_F16C 1
+#else
+#define ORBIT_HAS_F16C 0
+#endif
+
+/*
+* Sample formats of orbit::Delay's rings.
+* Float stores the samples as they are. Half and Int16 halve the ring's
+* memory and bandwidth: Half keeps about 11 bits of mantissa at any level,
+* Int16 is TPDF-dithered fixed point with Headroom above 0 dBFS.
+* store() converts on write (one sample or a contiguous run), load() on read.
+*/
+
+namespace orbit
+{
+	namespace storage
+	{
+		enum class Type { Float, Half, Int16, NumTypes };
+		static constexpr int NumTypes = static_cast<int>(Type::NumTypes);
+
+		/********** struct FloatFormat **********/
+		template<typename Float>
+		struct FloatFormat
+		{
+			using Sample = Float;
+
+			static Sample store(Float x, std::uint32_t) noexcept { return x; }
+			static Float load(Sample x) noexcept { return x; }
+			static void store(Sample* dest, const Float* src, int num, std::uint32_t) noexcept
+			{
+				std::copy(src, src + num, dest);
+			}
+		};
+
+		/********** struct HalfFormat **********/
+		template<typename Float>
+		struct HalfFormat
+		{
+			using Sample = std::uint16_t;
+
+			static Sample store(Float x, std::uint32_t) noexcept
+			{
+#if ORBIT_HAS_F16C
+				return static_cast<Sample>(_cvtss_sh(static_cast<float>(x), _MM_FROUND_TO_NEAREST_INT));
+#else
+				std::uint32_t bits;
+				const auto f = static_cast<float>(x);
+				std::memcpy(&bits, &f, sizeof(bits));
+				const auto sign = (bits >> 16) & 0x8000u;
+				const auto exponent = static_cast<int>((bits >> 23) & 0xffu) - 127 + 15;
+				auto mantissa = bits & 0x7fffffu;
+				if (exponent <= 0) // flush tiny values to zero
+					return static_cast<Sample>(sign);
+				if (exponent >= 31) // clip to the largest finite half
+					return static_cast<Sample>(sign | 0x7bffu);
+				mantissa += 0x1000u; // round to nearest
+				if (mantissa & 0x800000u)
+					return static_cast<Sample>(sign | ((exponent + 1) << 10));
+				return static_cast<Sample>(sign | (exponent << 10) | (mantissa >> 13));
+#endif
+			}
+
+			static void store(Sample* dest, const Float* src, int num, std::uint32_t n) noexcept
+			{
+				auto i = 0;
+#if ORBIT_HAS_F16C
+				if constexpr (std::is_same<Float, float>::value)
+					for (; i + 4 <= num; i += 4)
+					{
+						const auto half = _mm_cvtps_ph(_mm_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+						_mm_storel_epi64(reinterpret_cast<__m128i*>(dest + i), half);
+					}
+#endif
+				for (; i < num; ++i)
+					dest[i] = store(src[i], n);
+			}
+
+			static Float load(Sample x) noexcept
+			{
+#if ORBIT_HAS_F16C
+				return static_cast<Float>(_cvtsh_ss(x));
+#else
+				const auto sign = static_cast<std::uint32_t>(x & 0x8000u) << 16;
+				const auto exponent = (x >> 10) & 0x1fu;
+				const auto mantissa = static_cast<std::uint32_t>(x & 0x3ffu);
+				if (exponent == 0)
+					return static_cast<Float>(0);
+				const auto bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+				float f;
+				std::memcpy(&f, &bits, sizeof(f));
+				return static_cast<Float>(f);
+#endif
+			}
+		};
+
+		/********** struct Int16Format **********/
+		template<typename Float>
+		struct Int16Format
+		{
+			using Sample = std::int16_t;
+
+			static constexpr Float Headroom = static_cast<Float>(4); // +12 dBFS
+			static constexpr Float Scale = static_cast<Float>(32767) / Headroom;
+			static constexpr Float ScaleInv = static_cast<Float>(1) / Scale;
+
+			// n: running frame index of the ring. hashed into TPDF dither of +-1 LSB
+			static Sample store(Float x, std::uint32_t n) noexcept
+			{
+				auto h = n * 0x9e3779b1u;
+				h ^= h >> 15;
+				h *= 0x85ebca77u;
+				h ^= h >> 13;
+				const auto dither = static_cast<Float>(static_cast<int>(h & 0xffffu) + static_cast<int>(h >> 16) - 0xffff)
+					* static_cast<Float>(1. / 65536.);
+				const auto y = std::rint(x * Scale + dither);
+				const auto clipped = y > static_cast<Float>(32767) ? static_cast<Float>(32767) :
+					y < static_cast<Float>(-32767) ? static_cast<Float>(-32767) : y;
+				return static_cast<Sample>(clipped);
+			}
+
+			static void store(Sample* dest, const Float* src, int num, std::uint32_t n) noexcept
+			{
+				for (auto i = 0; i < num; ++i)
+					dest[i] = store(src[i], n + static_cast<std::uint32_t>(i));
+			}
+
+			static Float load(Sample x) noexcept
+			{
+				return static_cast<Float>(x) * ScaleInv;
+			}
+		};
+	}
+}
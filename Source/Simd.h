@@ -0,0 +1,329 @@
+#pragma once
+#include <cmath>
+#include <atomic>
+#include <juce_core/juce_core.h>
+
+/*
+* Runtime CPU dispatch of the hot DSP kernels.
+* SimdKernels.h holds the kernels once, written against a small vector type V.
+* It is included once per instruction set, each time inside a target region of the
+* compiler, so a single binary carries scalar, SSE2, AVX2 and AVX-512 versions.
+* select() picks one of them and get() returns it. The choice is process-wide: every
+* instance in the host shares one table, so only the first select() takes effect.
+* All kernels work on float. Double precision code stays on the scalar loops.
+*/
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ORBIT_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define ORBIT_SIMD_X86 0
+#endif
+
+namespace simd
+{
+	enum class Isa { Scalar, SSE2, AVX2, AVX512, NumIsas };
+	static constexpr int NumIsas = static_cast<int>(Isa::NumIsas);
+	// the most channels of a frame the frame kernels read. also the widest vector
+	static constexpr int MaxFrameSize = 16;
+
+	inline juce::String toString(Isa isa)
+	{
+		switch (isa)
+		{
+		case Isa::Scalar: return "scalar";
+		case Isa::SSE2: return "sse2";
+		case Isa::AVX2: return "avx2";
+		case Isa::AVX512: return "avx512";
+		default: return "";
+		}
+	}
+
+	/********** struct Kernels **********/
+	struct Kernels
+	{
+		// dest = val
+		using Fill = void(*)(float* dest, float val, int numSamples) noexcept;
+		// dest = val + dist * decay
+		using Ramp = void(*)(float* dest, float val, float dist, const float* decay, int numSamples) noexcept;
+		// dest = interleaved { l, r }
+		using Interleave = void(*)(float* dest, const float* l, const float* r, int numSamples) noexcept;
+		// dest = interleaved { l * gain, r * gain }
+		using InterleaveGain = void(*)(float* dest, const float* l, const float* r, const float* gain, int numSamples) noexcept;
+		// dest = interleaved { (l + r) * gain, (l - r) * gain }, gain == nullptr = 1
+		using InterleaveMidSide = void(*)(float* dest, const float* l, const float* r, const float* gain, int numSamples) noexcept;
+		/*
+		* stereo fractional delay read of numLanes taps. frames[l]: the interleaved stereo frames of lane l,
+		* weights[k * stride + l]: weight of point k of lane l, zero up to numPoints rounded up to 8.
+		* y[2 * l + ch] = sum over k of frames[l][2 * k + ch] * weight
+		*/
+		using ReadStereo = void(*)(const float* const* frames, const float* weights, int stride,
+			int numPoints, int numLanes, float* y) noexcept;
+		/*
+		* the same for frames of numChannels <= MaxFrameSize channels, vectorised across the channels.
+		* weights need numPoints points only. reads up to MaxFrameSize - 1 values past the last frame.
+		* y[MaxFrameSize * l + ch] = sum over k of frames[l][numChannels * k + ch] * weight
+		*/
+		using ReadFrames = void(*)(const float* const* frames, const float* weights, int stride,
+			int numPoints, int numLanes, int numChannels, float* y) noexcept;
+		// dryGain = sqrt(1 - mix), wetGain = sqrt(mix)
+		using EqualPower = void(*)(const float* mix, float* dryGain, float* wetGain, int numSamples) noexcept;
+		// wet = (dry * dryGain + wet * wetGain) * gain
+		using MixDryWet = void(*)(float* wet, const float* dry, const float* dryGain, const float* wetGain,
+			const float* gain, int numSamples) noexcept;
+		// the same with settled gains
+		using MixDryWetSteady = void(*)(float* wet, const float* dry, float dryGain, float wetGain,
+			float gain, int numSamples) noexcept;
+
+		Isa isa;
+		Fill fill;
+		Ramp ramp;
+		Interleave interleave;
+		InterleaveGain interleaveGain;
+		InterleaveMidSide interleaveMidSide;
+		ReadStereo readStereo;
+		ReadFrames readFrames;
+		EqualPower equalPower;
+		MixDryWet mixDryWet;
+		MixDryWetSteady mixDryWetSteady;
+	};
+
+	/********** struct VecScalar **********/
+	struct VecScalar
+	{
+		static constexpr int Width = 1;
+		float v;
+
+		static VecScalar load(const float* p) noexcept { return { *p }; }
+		static VecScalar set1(float x) noexcept { return { x }; }
+		void store(float* p) const noexcept { *p = v; }
+		static VecScalar add(VecScalar a, VecScalar b) noexcept { return { a.v + b.v }; }
+		static VecScalar sub(VecScalar a, VecScalar b) noexcept { return { a.v - b.v }; }
+		static VecScalar mul(VecScalar a, VecScalar b) noexcept { return { a.v * b.v }; }
+		static VecScalar fmadd(VecScalar a, VecScalar b, VecScalar c) noexcept { return { a.v * b.v + c.v }; }
+		static VecScalar sqrt(VecScalar a) noexcept { return { std::sqrt(a.v) }; }
+		static void interleave(VecScalar a, VecScalar b, float* dest) noexcept
+		{
+			dest[0] = a.v;
+			dest[1] = b.v;
+		}
+	};
+}
+
+#define SIMD_NAMESPACE scalar
+#define SIMD_VEC VecScalar
+#define SIMD_ISA Isa::Scalar
+#include "SimdKernels.h"
+
+#if ORBIT_SIMD_X86
+namespace simd
+{
+	/********** struct VecSSE2 **********/
+	struct VecSSE2
+	{
+		static constexpr int Width = 4;
+		__m128 v;
+
+		static VecSSE2 load(const float* p) noexcept { return { _mm_loadu_ps(p) }; }
+		static VecSSE2 set1(float x) noexcept { return { _mm_set1_ps(x) }; }
+		void store(float* p) const noexcept { _mm_storeu_ps(p, v); }
+		static VecSSE2 add(VecSSE2 a, VecSSE2 b) noexcept { return { _mm_add_ps(a.v, b.v) }; }
+		static VecSSE2 sub(VecSSE2 a, VecSSE2 b) noexcept { return { _mm_sub_ps(a.v, b.v) }; }
+		static VecSSE2 mul(VecSSE2 a, VecSSE2 b) noexcept { return { _mm_mul_ps(a.v, b.v) }; }
+		static VecSSE2 fmadd(VecSSE2 a, VecSSE2 b, VecSSE2 c) noexcept { return { _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v) }; }
+		static VecSSE2 sqrt(VecSSE2 a) noexcept { return { _mm_sqrt_ps(a.v) }; }
+		static void interleave(VecSSE2 a, VecSSE2 b, float* dest) noexcept
+		{
+			_mm_storeu_ps(dest, _mm_unpacklo_ps(a.v, b.v));
+			_mm_storeu_ps(dest + 4, _mm_unpackhi_ps(a.v, b.v));
+		}
+		// { w[0], w[0], w[stride], w[stride] }
+		static VecSSE2 loadDup(const float* w, int stride) noexcept
+		{
+			return { _mm_set_ps(w[stride], w[stride], w[0], w[0]) };
+		}
+		static void sumPairs(VecSSE2 a, float& even, float& odd) noexcept
+		{
+			const auto sum = _mm_add_ps(a.v, _mm_movehl_ps(a.v, a.v));
+			even = _mm_cvtss_f32(sum);
+			odd = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1));
+		}
+	};
+}
+
+#define SIMD_NAMESPACE sse2
+#define SIMD_VEC VecSSE2
+#define SIMD_ISA Isa::SSE2
+#include "SimdKernels.h"
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace simd
+{
+	/********** struct VecAVX2 **********/
+	struct VecAVX2
+	{
+		static constexpr int Width = 8;
+		__m256 v;
+
+		static VecAVX2 load(const float* p) noexcept { return { _mm256_loadu_ps(p) }; }
+		static VecAVX2 set1(float x) noexcept { return { _mm256_set1_ps(x) }; }
+		void store(float* p) const noexcept { _mm256_storeu_ps(p, v); }
+		static VecAVX2 add(VecAVX2 a, VecAVX2 b) noexcept { return { _mm256_add_ps(a.v, b.v) }; }
+		static VecAVX2 sub(VecAVX2 a, VecAVX2 b) noexcept { return { _mm256_sub_ps(a.v, b.v) }; }
+		static VecAVX2 mul(VecAVX2 a, VecAVX2 b) noexcept { return { _mm256_mul_ps(a.v, b.v) }; }
+		static VecAVX2 fmadd(VecAVX2 a, VecAVX2 b, VecAVX2 c) noexcept { return { _mm256_fmadd_ps(a.v, b.v, c.v) }; }
+		static VecAVX2 sqrt(VecAVX2 a) noexcept { return { _mm256_sqrt_ps(a.v) }; }
+		static void interleave(VecAVX2 a, VecAVX2 b, float* dest) noexcept
+		{
+			const auto lo = _mm256_unpacklo_ps(a.v, b.v);
+			const auto hi = _mm256_unpackhi_ps(a.v, b.v);
+			_mm256_storeu_ps(dest, _mm256_permute2f128_ps(lo, hi, 0x20));
+			_mm256_storeu_ps(dest + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+		}
+		static VecAVX2 loadDup(const float* w, int stride) noexcept
+		{
+			const auto x = _mm_set_ps(w[3 * stride], w[2 * stride], w[stride], w[0]);
+			const auto lo = _mm_unpacklo_ps(x, x);
+			const auto hi = _mm_unpackhi_ps(x, x);
+			return { _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1) };
+		}
+		static void sumPairs(VecAVX2 a, float& even, float& odd) noexcept
+		{
+			const auto x = _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+			const auto sum = _mm_add_ps(x, _mm_movehl_ps(x, x));
+			even = _mm_cvtss_f32(sum);
+			odd = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1));
+		}
+	};
+}
+
+#define SIMD_NAMESPACE avx2
+#define SIMD_VEC VecAVX2
+#define SIMD_ISA Isa::AVX2
+#include "SimdKernels.h"
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push(__attribute__((target("avx512f,avx2,fma"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,fma")
+#endif
+
+namespace simd
+{
+	/********** struct VecAVX512 **********/
+	struct VecAVX512
+	{
+		static constexpr int Width = 16;
+		using Half = VecAVX2;
+		__m512 v;
+
+		static VecAVX512 load(const float* p) noexcept { return { _mm512_loadu_ps(p) }; }
+		static VecAVX512 set1(float x) noexcept { return { _mm512_set1_ps(x) }; }
+		void store(float* p) const noexcept { _mm512_storeu_ps(p, v); }
+		static VecAVX512 add(VecAVX512 a, VecAVX512 b) noexcept { return { _mm512_add_ps(a.v, b.v) }; }
+		static VecAVX512 sub(VecAVX512 a, VecAVX512 b) noexcept { return { _mm512_sub_ps(a.v, b.v) }; }
+		static VecAVX512 mul(VecAVX512 a, VecAVX512 b) noexcept { return { _mm512_mul_ps(a.v, b.v) }; }
+		static VecAVX512 fmadd(VecAVX512 a, VecAVX512 b, VecAVX512 c) noexcept { return { _mm512_fmadd_ps(a.v, b.v, c.v) }; }
+		static VecAVX512 sqrt(VecAVX512 a) noexcept { return { _mm512_sqrt_ps(a.v) }; }
+		static void interleave(VecAVX512 a, VecAVX512 b, float* dest) noexcept
+		{
+			const auto idxLo = _mm512_set_epi32(23, 7, 22, 6, 21, 5, 20, 4, 19, 3, 18, 2, 17, 1, 16, 0);
+			const auto idxHi = _mm512_set_epi32(31, 15, 30, 14, 29, 13, 28, 12, 27, 11, 26, 10, 25, 9, 24, 8);
+			_mm512_storeu_ps(dest, _mm512_permutex2var_ps(a.v, idxLo, b.v));
+			_mm512_storeu_ps(dest + 16, _mm512_permutex2var_ps(a.v, idxHi, b.v));
+		}
+		static VecAVX512 loadDup(const float* w, int stride) noexcept
+		{
+			const auto x = _mm256_set_ps(w[7 * stride], w[6 * stride], w[5 * stride], w[4 * stride],
+				w[3 * stride], w[2 * stride], w[stride], w[0]);
+			const auto idx = _mm512_set_epi32(7, 7, 6, 6, 5, 5, 4, 4, 3, 3, 2, 2, 1, 1, 0, 0);
+			return { _mm512_permutexvar_ps(idx, _mm512_castps256_ps512(x)) };
+		}
+		static void sumPairs(VecAVX512 a, float& even, float& odd) noexcept
+		{
+			const auto hi = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(a.v), 1));
+			const auto y = _mm256_add_ps(_mm512_castps512_ps256(a.v), hi);
+			const auto x = _mm_add_ps(_mm256_castps256_ps128(y), _mm256_extractf128_ps(y, 1));
+			const auto sum = _mm_add_ps(x, _mm_movehl_ps(x, x));
+			even = _mm_cvtss_f32(sum);
+			odd = _mm_cvtss_f32(_mm_shuffle_ps(sum, sum, 1));
+		}
+	};
+}
+
+#define SIMD_NAMESPACE avx512
+#define SIMD_VEC VecAVX512
+#define SIMD_ISA Isa::AVX512
+#include "SimdKernels.h"
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif
+
+namespace simd
+{
+	// the widest instruction set this CPU and OS support
+	inline Isa detect() noexcept
+	{
+#if ORBIT_SIMD_X86
+		if (juce::SystemStats::hasAVX512F())
+			return Isa::AVX512;
+		if (juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3())
+			return Isa::AVX2;
+		if (juce::SystemStats::hasSSE2())
+			return Isa::SSE2;
+#endif
+		return Isa::Scalar;
+	}
+
+	inline const Kernels& getKernels(Isa isa) noexcept
+	{
+		switch (isa)
+		{
+#if ORBIT_SIMD_X86
+		case Isa::SSE2: return sse2::kernels;
+		case Isa::AVX2: return avx2::kernels;
+		case Isa::AVX512: return avx512::kernels;
+#endif
+		default: return scalar::kernels;
+		}
+	}
+
+	inline std::atomic<const Kernels*>& current() noexcept
+	{
+		static std::atomic<const Kernels*> kernels{ &scalar::kernels };
+		return kernels;
+	}
+
+	/*
+	* isa is limited to what detect() allows. only the first call of the process applies it,
+	* so preparing one instance never swaps the kernels under another one mid-block.
+	* a changed setting takes effect once the host loads the plugin again
+	*/
+	inline void select(Isa isa) noexcept
+	{
+		static std::atomic<bool> selected{ false };
+		if (selected.exchange(true))
+			return;
+		const auto supported = static_cast<int>(detect());
+		const auto idx = juce::jlimit(0, supported, static_cast<int>(isa));
+		current().store(&getKernels(static_cast<Isa>(idx)));
+	}
+
+	inline const Kernels& get() noexcept
+	{
+		return *current().load(std::memory_order_relaxed);
+	}
+}
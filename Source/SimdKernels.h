@@ -0,0 +1,219 @@
+// no include guard: Simd.h includes this once per instruction set, with
+// SIMD_NAMESPACE, SIMD_VEC and SIMD_ISA naming the version to build.
+
+namespace simd
+{
+	namespace SIMD_NAMESPACE
+	{
+		using V = SIMD_VEC;
+
+		inline void fill(float* dest, float val, int numSamples) noexcept
+		{
+			const auto v = V::set1(val);
+			auto s = 0;
+			for (; s + V::Width <= numSamples; s += V::Width)
+				v.store(dest + s);
+			for (; s < numSamples; ++s)
+				dest[s] = val;
+		}
+
+		inline void ramp(float* dest, float val, float dist, const float* decay, int numSamples) noexcept
+		{
+			const auto v = V::set1(val);
+			const auto d = V::set1(dist);
+			auto s = 0;
+			for (; s + V::Width <= numSamples; s += V::Width)
+				V::fmadd(d, V::load(decay + s), v).store(dest + s);
+			for (; s < numSamples; ++s)
+				dest[s] = val + dist * decay[s];
+		}
+
+		inline void interleave(float* dest, const float* l, const float* r, int numSamples) noexcept
+		{
+			auto s = 0;
+			for (; s + V::Width <= numSamples; s += V::Width)
+				V::interleave(V::load(l + s), V::load(r + s), dest + 2 * s);
+			for (; s < numSamples; ++s)
+			{
+				dest[2 * s] = l[s];
+				dest[2 * s + 1] = r[s];
+			}
+		}
+
+		inline void interleaveGain(float* dest, const float* l, const float* r, const float* gain, int numSamples) noexcept
+		{
+			auto s = 0;
+			for (; s + V::Width <= numSamples; s += V::Width)
+			{
+				const auto g = V::load(gain + s);
+				V::interleave(V::mul(V::load(l + s), g), V::mul(V::load(r + s), g), dest + 2 * s);
+			}
+			for (; s < numSamples; ++s)
+			{
+				dest[2 * s] = l[s] * gain[s];
+				dest[2 * s + 1] = r[s] * gain[s];
+			}
+		}
+
+		// the mid/side encoder without its .5, which the engine's output gain takes
+		inline void interleaveMidSide(float* dest, const float* l, const float* r, const float* gain, int numSamples) noexcept
+		{
+			auto s = 0;
+			if (gain == nullptr)
+				for (; s + V::Width <= numSamples; s += V::Width)
+				{
+					const auto a = V::load(l + s);
+					const auto b = V::load(r + s);
+					V::interleave(V::add(a, b), V::sub(a, b), dest + 2 * s);
+				}
+			else
+				for (; s + V::Width <= numSamples; s += V::Width)
+				{
+					const auto a = V::load(l + s);
+					const auto b = V::load(r + s);
+					const auto g = V::load(gain + s);
+					V::interleave(V::mul(V::add(a, b), g), V::mul(V::sub(a, b), g), dest + 2 * s);
+				}
+			for (; s < numSamples; ++s)
+			{
+				const auto g = gain == nullptr ? 1.f : gain[s];
+				dest[2 * s] = (l[s] + r[s]) * g;
+				dest[2 * s + 1] = (l[s] - r[s]) * g;
+			}
+		}
+
+		// vectorised along the points of each lane: one load covers Width / 2 stereo frames
+		template<typename Vec>
+		inline void readStereo(const float* const* frames, const float* weights, int stride,
+			int numPoints, int numLanes, float* y) noexcept
+		{
+			if constexpr (Vec::Width == 1)
+			{
+				for (auto l = 0; l < numLanes; ++l)
+				{
+					const auto f = frames[l];
+					auto yL = 0.f;
+					auto yR = 0.f;
+					for (auto k = 0; k < numPoints; ++k)
+					{
+						const auto w = weights[k * stride + l];
+						yL += f[2 * k] * w;
+						yR += f[2 * k + 1] * w;
+					}
+					y[2 * l] = yL;
+					y[2 * l + 1] = yR;
+				}
+			}
+			else
+			{
+				// short reads would leave most of a 512 bit vector idle
+				if constexpr (Vec::Width == 16)
+					if (numPoints <= Vec::Width / 4)
+						return readStereo<typename Vec::Half>(frames, weights, stride, numPoints, numLanes, y);
+
+				static constexpr int PointsPerVec = Vec::Width / 2;
+				for (auto l = 0; l < numLanes; ++l)
+				{
+					const auto f = frames[l];
+					const auto w = weights + l;
+					auto acc = Vec::set1(0.f);
+					for (auto k = 0; k < numPoints; k += PointsPerVec)
+						acc = Vec::fmadd(Vec::load(f + 2 * k), Vec::loadDup(w + k * stride, stride), acc);
+					Vec::sumPairs(acc, y[2 * l], y[2 * l + 1]);
+				}
+			}
+		}
+
+		// vectorised along the channels of each frame. the values past numChannels are junk
+		template<typename Vec>
+		inline void readFrames(const float* const* frames, const float* weights, int stride,
+			int numPoints, int numLanes, int numChannels, float* y) noexcept
+		{
+			// narrow frames would leave most of a 512 bit vector idle
+			if constexpr (Vec::Width == 16)
+				if (numChannels <= Vec::Width / 2)
+					return readFrames<typename Vec::Half>(frames, weights, stride, numPoints, numLanes, numChannels, y);
+
+			for (auto l = 0; l < numLanes; ++l)
+			{
+				const auto f = frames[l];
+				const auto w = weights + l;
+				const auto yL = y + l * MaxFrameSize;
+				for (auto c0 = 0; c0 < numChannels; c0 += Vec::Width)
+				{
+					auto acc = Vec::set1(0.f);
+					for (auto k = 0; k < numPoints; ++k)
+						acc = Vec::fmadd(Vec::load(f + k * numChannels + c0), Vec::set1(w[k * stride]), acc);
+					acc.store(yL + c0);
+				}
+			}
+		}
+
+		inline void equalPower(const float* mix, float* dryGain, float* wetGain, int numSamples) noexcept
+		{
+			const auto one = V::set1(1.f);
+			auto s = 0;
+			for (; s + V::Width <= numSamples; s += V::Width)
+			{
+				const auto x = V::load(mix + s);
+				V::sqrt(V::sub(one, x)).store(dryGain + s);
+				V::sqrt(x).store(wetGain + s);
+			}
+			for (; s < numSamples; ++s)
+			{
+				dryGain[s] = std::sqrt(1.f - mix[s]);
+				wetGain[s] = std::sqrt(mix[s]);
+			}
+		}
+
+		inline void mixDryWet(float* wet, const float* dry, const float* dryGain, const float* wetGain,
+			const float* gain, int numSamples) noexcept
+		{
+			auto s = 0;
+			for (; s + V::Width <= numSamples; s += V::Width)
+			{
+				const auto d = V::mul(V::load(dry + s), V::load(dryGain + s));
+				const auto y = V::fmadd(V::load(wet + s), V::load(wetGain + s), d);
+				V::mul(y, V::load(gain + s)).store(wet + s);
+			}
+			for (; s < numSamples; ++s)
+				wet[s] = (dry[s] * dryGain[s] + wet[s] * wetGain[s]) * gain[s];
+		}
+
+		inline void mixDryWetSteady(float* wet, const float* dry, float dryGain, float wetGain,
+			float gain, int numSamples) noexcept
+		{
+			const auto dg = V::set1(dryGain);
+			const auto wg = V::set1(wetGain);
+			const auto g = V::set1(gain);
+			auto s = 0;
+			for (; s + V::Width <= numSamples; s += V::Width)
+			{
+				const auto d = V::mul(V::load(dry + s), dg);
+				V::mul(V::fmadd(V::load(wet + s), wg, d), g).store(wet + s);
+			}
+			for (; s < numSamples; ++s)
+				wet[s] = (dry[s] * dryGain + wet[s] * wetGain) * gain;
+		}
+
+		// constant-initialised, so nothing of this instruction set runs before it is selected
+		inline constexpr Kernels kernels
+		{
+			SIMD_ISA,
+			&fill,
+			&ramp,
+			&interleave,
+			&interleaveGain,
+			&interleaveMidSide,
+			&readStereo<V>,
+			&readFrames<V>,
+			&equalPower,
+			&mixDryWet,
+			&mixDryWetSteady
+		};
+	}
+}
+
+#undef SIMD_NAMESPACE
+#undef SIMD_VEC
+#undef SIMD_ISA
@@ -0,0 +1,223 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <atomic>
+#include <juce_core/juce_core.h>
+#include "Orbit.h"
+
+/*
+* Modulation trace capture. Enable with TraceMacro = 1 in the project's defines.
+* The audio thread copies each block's smoothed phase and magnitude buffers into
+* a preallocated SPSC FIFO of frames and a background thread streams them to
+* <user app data>/Mrugalla/NELOrbit/traces/trace.nelt.
+* Each plugin instance records into one file for as long as it lives. Re-preparing
+* appends to it, unless the sample rate changed or the block size outgrew the one
+* in the file's header, which starts the next file.
+* Tools/TraceReader converts those files to CSV.
+*
+* File layout (little endian):
+* header: char[4] "NELT", int32 version, float64 sampleRate, int32 maxPlanets, int32 maxBlockSize
+* record: int64 samplePos, float64 timeSecs, int32 numDropped, int32 numPlanets, int32 numSamples,
+*         int32 numActiveTaps (version 2), float32 phase[numPlanets][numSamples], float32 mag[numPlanets][numSamples]
+*/
+
+#ifndef TraceMacro
+#define TraceMacro 0
+#endif
+
+namespace trace
+{
+	static constexpr int Version = 2;
+
+	/********** struct Frame **********/
+	struct Frame
+	{
+		using Buf = std::vector<float>;
+
+		Frame() :
+			phase(), mag(),
+			samplePos(0), ticks(0),
+			numDropped(0), numPlanets(0), numSamples(0), numActiveTaps(0)
+		{}
+
+		void prepare(int maxPlanets, int blockSize)
+		{
+			phase.resize(maxPlanets * blockSize, 0.f);
+			mag.resize(maxPlanets * blockSize, 0.f);
+		}
+
+		Buf phase, mag;
+		juce::int64 samplePos, ticks;
+		int numDropped, numPlanets, numSamples, numActiveTaps;
+	};
+
+	/********** struct Recorder **********/
+	template<size_t NumPlanets>
+	struct Recorder :
+		public juce::Thread
+	{
+		static constexpr int NumFrames = 64;
+		static constexpr int WriterIntervalMs = 20;
+
+		using Frames = std::array<Frame, NumFrames>;
+
+		Recorder() :
+			juce::Thread("NELOrbit Trace"),
+			fifo(NumFrames),
+			frames(),
+			stream(),
+			sampleRate(48000.),
+			samplePos(0),
+			blockSize(0),
+			fileBlockSize(0),
+			numDropped(0)
+		{}
+
+		~Recorder() override
+		{
+			stop();
+			stream.reset();
+		}
+
+		// call from prepareToPlay. keeps recording into the current file if it can hold the new blocks
+		void prepare(double _sampleRate, int _blockSize)
+		{
+			stop();
+			blockSize = _blockSize;
+			fifo.reset();
+			for (auto& frame : frames)
+				frame.prepare(static_cast<int>(NumPlanets), blockSize);
+
+			if (stream == nullptr || _sampleRate != sampleRate || blockSize > fileBlockSize)
+			{
+				stream.reset();
+				sampleRate = _sampleRate;
+				samplePos = 0;
+				numDropped.store(0);
+				if (!openStream())
+					return;
+			}
+			startThread();
+		}
+
+		// call from releaseResources. writes what's left, the file stays open for the next prepare
+		void stop()
+		{
+			stopThread(1000);
+			if (stream != nullptr)
+				stream->flush();
+		}
+
+		// audio thread. never blocks, counts the block as dropped if the writer falls behind
+		// uniBuf: an orbit::UniversalBuffer of any precision, recorded as float. numActiveTaps: planets the delays didn't cull
+		template<typename UniBuf>
+		void push(const UniBuf& uniBuf, int numPlanets, int numSamples, int numActiveTaps) noexcept
+		{
+			const auto pos = samplePos;
+			samplePos += numSamples;
+
+			if (fifo.getFreeSpace() == 0 || numSamples > blockSize)
+			{
+				numDropped.store(numDropped.load() + 1);
+				return;
+			}
+
+			int start1, size1, start2, size2;
+			fifo.prepareToWrite(1, start1, size1, start2, size2);
+			auto& frame = frames[size1 != 0 ? start1 : start2];
+
+			frame.samplePos = pos;
+			frame.ticks = juce::Time::getHighResolutionTicks();
+			frame.numDropped = numDropped.load();
+			frame.numPlanets = numPlanets;
+			frame.numSamples = numSamples;
+			frame.numActiveTaps = numActiveTaps;
+			for (auto p = 0; p < numPlanets; ++p)
+			{
+				const auto offset = p * numSamples;
+				const auto phase = uniBuf[p].getPhaseBuf();
+				const auto mag = uniBuf[p].getMagBuf();
+				std::copy(phase, phase + numSamples, &frame.phase[offset]);
+				std::copy(mag, mag + numSamples, &frame.mag[offset]);
+			}
+
+			fifo.finishedWrite(1);
+		}
+
+		int getNumDropped() const noexcept { return numDropped.load(); }
+
+		void run() override
+		{
+			while (!threadShouldExit())
+			{
+				drain();
+				wait(WriterIntervalMs);
+			}
+			drain();
+		}
+	private:
+		juce::AbstractFifo fifo;
+		Frames frames;
+		std::unique_ptr<juce::FileOutputStream> stream;
+		double sampleRate;
+		juce::int64 samplePos;
+		// fileBlockSize: the largest block the current file's header allows
+		int blockSize, fileBlockSize;
+		std::atomic<int> numDropped;
+
+		bool openStream()
+		{
+			const auto folder = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+				.getChildFile("Mrugalla").getChildFile(JucePlugin_Name).getChildFile("traces");
+			if (!folder.createDirectory())
+				return false;
+
+			const auto file = folder.getChildFile("trace.nelt").getNonexistentSibling();
+			stream = std::make_unique<juce::FileOutputStream>(file);
+			if (stream->failedToOpen())
+			{
+				stream.reset();
+				return false;
+			}
+
+			stream->write("NELT", 4);
+			stream->writeInt(Version);
+			stream->writeDouble(sampleRate);
+			stream->writeInt(static_cast<int>(NumPlanets));
+			stream->writeInt(blockSize);
+			fileBlockSize = blockSize;
+			return true;
+		}
+
+		void drain()
+		{
+			const auto numReady = fifo.getNumReady();
+			if (numReady == 0 || stream == nullptr)
+				return;
+
+			int start1, size1, start2, size2;
+			fifo.prepareToRead(numReady, start1, size1, start2, size2);
+			for (auto i = 0; i < size1; ++i)
+				write(frames[start1 + i]);
+			for (auto i = 0; i < size2; ++i)
+				write(frames[start2 + i]);
+			fifo.finishedRead(size1 + size2);
+			stream->flush();
+		}
+
+		void write(const Frame& frame)
+		{
+			const auto numValues = static_cast<size_t>(frame.numPlanets * frame.numSamples);
+			const auto timeSecs = juce::Time::highResolutionTicksToSeconds(frame.ticks);
+
+			stream->writeInt64(frame.samplePos);
+			stream->writeDouble(timeSecs);
+			stream->writeInt(frame.numDropped);
+			stream->writeInt(frame.numPlanets);
+			stream->writeInt(frame.numSamples);
+			stream->writeInt(frame.numActiveTaps);
+			stream->write(frame.phase.data(), numValues * sizeof(float));
+			stream->write(frame.mag.data(), numValues * sizeof(float));
+		}
+	};
+}
@@ -423,14 +423,14 @@ namespace orbit
 		{
             using PID = param::PID;
 
-            enum class PIdx { Depth, Mix, Gain, StereoConfig, NumPlanets, Gravity, SpaceMud, Attraction, NumParams };
+            enum class PIdx { Depth, Mix, Gain, StereoConfig, NumPlanets, Gravity, SpaceMud, Attraction, Interpolation, MaxTime, NumParams };
             static constexpr int NumParams = static_cast<int>(PIdx::NumParams);
 
 #define FPS 30.f
             UI(Utils& u) :
                 menuLayout(
                     { 20, 70, 20 },
-                    { 5, 30, 2, 20, 20, 20, 20, 30, 30, 30, 30, 2, 5 }
+                    { 5, 30, 2, 20, 20, 20, 20, 30, 30, 30, 30, 20, 20, 2, 5 }
                 ),
 				Comp(u),
                 Timer(),
@@ -446,7 +446,9 @@ namespace orbit
                     Paramtr(u, "Num Planets", "tooltip", PID::NumPlanets),
                     Paramtr(u, "Gravity", "tooltip", PID::Gravity),
                     Paramtr(u, "Space Mud", "tooltip", PID::SpaceMud),
-                    Paramtr(u, "Attraction", "tooltip", PID::Attraction)
+                    Paramtr(u, "Attraction", "tooltip", PID::Attraction),
+                    Paramtr(u, "Interpolation", "tooltip", PID::Interpolation),
+                    Paramtr(u, "Max Time", "tooltip", PID::MaxTime)
                 }
 			{
                 title.font = u.font;
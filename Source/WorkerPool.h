@@ -0,0 +1,257 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <juce_core/juce_core.h>
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#include <immintrin.h>
+#define WORKERS_PAUSE() _mm_pause()
+#else
+#define WORKERS_PAUSE() std::atomic_signal_fence(std::memory_order_seq_cst)
+#endif
+
+/*
+* Real-time worker pool for splitting one block's work across cores.
+* The workers are spawned in prepare() and never allocate or lock while a block
+* is processed. The audio thread publishes a batch of jobs, claims jobs itself like
+* any worker and only spins on the ones still running on other threads, so a batch
+* never waits for a worker that didn't wake up in time.
+* Jobs are claimed from one atomic cursor that also holds the batch's generation and
+* size, so a worker that wakes up late can't take jobs of the next batch.
+* Idle workers spin for SpinIterations, then park until the next batch wakes them.
+* A worker parks by waiting on its own atomic, which the audio thread bumps and wakes
+* with notify_one: a futex wake or the platform's equivalent. That is a syscall, but
+* it takes no lock the worker could hold, so the audio thread can't block on it.
+* Every ProbeInterval batches the audio thread runs one batch alone, to know how long
+* a job takes it without workers competing for its core. If batches keep taking as
+* long as the audio thread alone would have needed for them, the host is using every
+* core already and the pool degrades to running batches on the audio thread alone
+* for BackoffBatches, before it tries again. A caller that has a cheaper way to do a
+* batch's work without splitting it may do so while !isParallel(), and report the
+* batch with skip() instead of run().
+*/
+
+namespace workers
+{
+	static constexpr int MaxThreads = 8;
+
+	// runs job number job of a batch
+	using Task = void(*)(void* context, int job) noexcept;
+
+	/********** struct Pool **********/
+	struct Pool
+	{
+		static constexpr int SpinIterations = 1 << 12;
+		static constexpr int MaxStarvedBatches = 8;
+		static constexpr int BackoffBatches = 1 << 10;
+		static constexpr int ProbeInterval = 1 << 6;
+
+		Pool() :
+			workers(),
+			task(nullptr),
+			context(nullptr),
+			cursor(0),
+			numDone(0),
+			numThreads(1),
+			numStarved(0),
+			backoff(0),
+			untilProbe(0),
+			jobTicks(0)
+		{}
+
+		~Pool()
+		{
+			release();
+		}
+
+		// call from prepareToPlay. _numThreads counts the audio thread, <= 1 disables the pool
+		void prepare(int _numThreads)
+		{
+			release();
+			numThreads = juce::jlimit(1, std::min(MaxThreads, juce::SystemStats::getNumCpus()), _numThreads);
+			numStarved = 0;
+			backoff = 0;
+			untilProbe = 0;
+			jobTicks = 0;
+			for (auto i = 0; i < numThreads - 1; ++i)
+			{
+				workers[i] = std::make_unique<Worker>(*this, i);
+				workers[i]->startThread(juce::Thread::Priority::highest);
+			}
+		}
+
+		void release()
+		{
+			for (auto& worker : workers)
+				if (worker != nullptr)
+					worker->signalThreadShouldExit();
+			for (auto& worker : workers)
+				if (worker != nullptr)
+				{
+					worker->wake();
+					worker->stopThread(1000);
+					worker.reset();
+				}
+			numThreads = 1;
+		}
+
+		// audio thread. runs _task for the jobs [0, _numJobs) and returns once all of them are done
+		void run(Task _task, void* _context, int _numJobs) noexcept
+		{
+			const auto start = juce::Time::getHighResolutionTicks();
+			if (!isParallel() || _numJobs < 2)
+			{
+				for (auto j = 0; j < _numJobs; ++j)
+					_task(_context, j);
+				skip(juce::Time::getHighResolutionTicks() - start, _numJobs);
+				return;
+			}
+
+			task = _task;
+			context = _context;
+			numDone.store(0, std::memory_order_relaxed);
+			const auto generation = getGeneration() + 1;
+			cursor.store((static_cast<std::uint64_t>(generation) << 32) | (static_cast<std::uint64_t>(_numJobs) << 16),
+				std::memory_order_seq_cst);
+			for (auto i = 0; i < numThreads - 1; ++i)
+				if (workers[i]->isParked())
+					workers[i]->wake();
+
+			--untilProbe;
+			work(generation);
+			while (numDone.load(std::memory_order_acquire) != _numJobs)
+				WORKERS_PAUSE();
+			const auto batchTicks = juce::Time::getHighResolutionTicks() - start;
+
+			// no faster than without the workers
+			if (batchTicks >= jobTicks * _numJobs)
+			{
+				if (++numStarved >= MaxStarvedBatches)
+				{
+					numStarved = 0;
+					backoff = BackoffBatches;
+				}
+			}
+			else
+				numStarved = 0;
+		}
+
+		// audio thread. counts a batch of numJobs the caller ran on its own in ticks, without run(),
+		// because the pool wasn't parallel. callers that can do a batch's work cheaper in one go use it
+		void skip(juce::int64 ticks, int numJobs) noexcept
+		{
+			if (numThreads < 2)
+				return;
+			if (backoff > 0)
+				--backoff;
+			else
+				untilProbe = ProbeInterval;
+			updateJobTicks(ticks, numJobs);
+		}
+
+		// false while the pool is disabled, degraded to the audio thread or probing it
+		bool isParallel() const noexcept { return numThreads > 1 && backoff == 0 && untilProbe > 0; }
+		// the threads, including the audio thread, batches are split across when enabled
+		int getNumThreads() const noexcept { return numThreads; }
+	private:
+		/********** struct Worker **********/
+		struct Worker :
+			public juce::Thread
+		{
+			Worker(Pool& _pool, int idx) :
+				juce::Thread("NELOrbit Worker " + juce::String(idx + 1)),
+				pool(_pool),
+				wakeups(0),
+				parked(false)
+			{}
+
+			bool isParked() const noexcept { return parked.load(std::memory_order_seq_cst); }
+
+			void wake() noexcept
+			{
+				wakeups.fetch_add(1, std::memory_order_seq_cst);
+				wakeups.notify_one();
+			}
+
+			void run() override
+			{
+				auto seen = static_cast<std::uint32_t>(pool.cursor.load(std::memory_order_acquire) >> 32);
+				while (!threadShouldExit())
+				{
+					auto generation = seen;
+					for (auto i = 0; i < SpinIterations && generation == seen; ++i)
+					{
+						WORKERS_PAUSE();
+						generation = pool.getGeneration();
+					}
+
+					if (generation == seen)
+					{
+						// the audio thread checks parked after publishing, so one of both sees the other.
+						// a wake after the ticket was taken changes wakeups, so wait returns right away
+						const auto ticket = wakeups.load(std::memory_order_seq_cst);
+						parked.store(true, std::memory_order_seq_cst);
+						if (pool.getGeneration() == seen && !threadShouldExit())
+							wakeups.wait(ticket, std::memory_order_seq_cst);
+						parked.store(false, std::memory_order_seq_cst);
+						continue;
+					}
+
+					seen = generation;
+					pool.work(generation);
+				}
+			}
+		private:
+			Pool& pool;
+			std::atomic<std::uint32_t> wakeups;
+			std::atomic<bool> parked;
+		};
+
+		std::array<std::unique_ptr<Worker>, MaxThreads - 1> workers;
+		Task task;
+		void* context;
+		// bits 32-63: generation of the batch, 16-31: its number of jobs, 0-15: the next unclaimed job
+		std::atomic<std::uint64_t> cursor;
+		std::atomic<int> numDone;
+		int numThreads, numStarved, backoff, untilProbe;
+		juce::int64 jobTicks;
+
+		std::uint32_t getGeneration() const noexcept
+		{
+			// seq_cst, parking orders it after the store to parked
+			return static_cast<std::uint32_t>(cursor.load(std::memory_order_seq_cst) >> 32);
+		}
+
+		// running average of the time one job takes the audio thread alone
+		void updateJobTicks(juce::int64 ticks, int numJobs) noexcept
+		{
+			if (numJobs == 0)
+				return;
+			const auto ticksPerJob = ticks / numJobs;
+			jobTicks = jobTicks == 0 ? ticksPerJob : (3 * jobTicks + ticksPerJob) / 4;
+		}
+
+		// claims and runs jobs of the batch generation until none are left
+		void work(std::uint32_t generation) noexcept
+		{
+			auto cur = cursor.load(std::memory_order_acquire);
+			while (true)
+			{
+				if (static_cast<std::uint32_t>(cur >> 32) != generation)
+					return;
+				const auto job = static_cast<int>(cur & 0xffffu);
+				if (job >= static_cast<int>((cur >> 16) & 0xffffu))
+					return;
+				if (!cursor.compare_exchange_weak(cur, cur + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+					continue;
+
+				task(context, job);
+				numDone.fetch_add(1, std::memory_order_release);
+				cur = cursor.load(std::memory_order_acquire);
+			}
+		}
+	};
+}
+
+#undef WORKERS_PAUSE
@@ -0,0 +1,645 @@
+/*
+* Benchmarks of the hot paths in Source/, the numbers the commit messages quote.
+* Unless a mode says otherwise: 48 kHz, stereo, 512-sample blocks, 24 planets, Max Time 40 ms.
+* Modes:
+*   multitap       the planet delays against the original per-planet Delays, per number of planets
+*   interpolation  cost per tap and error against the ideal fractional delay of each interpolation type
+*   storage        error and cost of the half and int16 rings against float ones
+*   oversampling   cost of the planet bus at 1x, 2x and 4x and the share of the half-band filters
+*   pool           the planet delays split across 1 to 8 threads of the worker pool
+*   snapshot       reading the parameters per call against the per-block snapshot, and dry/wet with mix and gain moving or settled
+* Timings are noisy on a busy machine. Run each mode a few times.
+*
+* build: c++ -std=c++20 -O2 -DNumPlanetsMacro=24 -DJUCE_GLOBAL_MODULE_SETTINGS_INCLUDED=1 -DJUCE_STANDALONE_APPLICATION=1
+*        -I../../Source -I$JUCE/modules Bench.cpp
+*        $JUCE/modules/juce_core/juce_core.cpp $JUCE/modules/juce_events/juce_events.cpp
+*        $JUCE/modules/juce_data_structures/juce_data_structures.cpp $JUCE/modules/juce_audio_basics/juce_audio_basics.cpp
+*        $JUCE/modules/juce_graphics/juce_graphics.cpp $JUCE/modules/juce_gui_basics/juce_gui_basics.cpp
+*        $JUCE/modules/juce_gui_extra/juce_gui_extra.cpp $JUCE/modules/juce_audio_processors/juce_audio_processors.cpp
+*        -lpthread -ldl -lfreetype -o Bench
+* usage: Bench multitap|interpolation|storage|oversampling|pool|snapshot
+*/
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include "Orbit.h"
+#include "Oversampling.h"
+#include "Param.h"
+#include "DryWetProcessor.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+	using Orbit = orbit::Processor<float, NumPlanetsMacro>;
+	using UniBuf = orbit::UniversalBuffer<float, NumPlanetsMacro>;
+	using Delays = orbit::ResizingMultiTap<float, NumPlanetsMacro>;
+	using Interpolation = orbit::interpolation::Type;
+	using Storage = orbit::storage::Type;
+
+	static constexpr float SampleRate = 48000.f;
+	static constexpr int BlockSize = 512;
+	static constexpr int NumChannels = 2;
+	static constexpr float MaxTimeMs = 40.f;
+	static constexpr int NumBlocks = 400;
+
+	double getSeconds(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	double toNsPerSample(double seconds, int numBlocks = NumBlocks, int blockSize = BlockSize)
+	{
+		return seconds * 1e9 / (static_cast<double>(numBlocks) * blockSize);
+	}
+
+	// the same planets on every run, drawn like giveBirthWithRandomProperties does
+	void seedPlanets(Orbit& orbit, unsigned seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> bi(-1.f, 1.f), uni(0.f, 1.f);
+		for (auto p = 0; p < NumPlanetsMacro; ++p)
+		{
+			orbit::Vec2D<float> pos(bi(rng), bi(rng)), dir(bi(rng) * .001f, bi(rng) * .001f);
+			const auto mass = .3f + uni(rng) * .6f;
+			const auto radius = .001f + uni(rng) * .009f;
+			orbit.giveBirthToPlanet({ std::move(pos), std::move(dir), mass, radius }, p);
+		}
+	}
+
+	/********** struct Stereo **********/
+	// a block of the test signal, continuous from block to block
+	struct Stereo
+	{
+		Stereo(int blockSize = BlockSize) :
+			bufs(),
+			ptrs()
+		{
+			for (auto ch = 0; ch < NumChannels; ++ch)
+			{
+				bufs[ch].assign(blockSize, 0.f);
+				ptrs[ch] = bufs[ch].data();
+			}
+		}
+
+		float** fill(int b) noexcept
+		{
+			const auto blockSize = static_cast<int>(bufs[0].size());
+			for (auto s = 0; s < blockSize; ++s)
+			{
+				const auto n = static_cast<float>(b * blockSize + s);
+				bufs[0][s] = .5f * std::sin(n * .03f);
+				bufs[1][s] = .5f * std::cos(n * .021f);
+			}
+			return ptrs.data();
+		}
+
+		std::array<std::vector<float>, NumChannels> bufs;
+		std::array<float*, NumChannels> ptrs;
+	};
+
+	/********** struct Chain **********/
+	// the planets, their modulation and the delays, as processPlanets runs them
+	struct Chain
+	{
+		Chain(unsigned seed, bool sharedHistory = false, Storage storage = Storage::Float) :
+			orbit(11),
+			uniBuf(),
+			delays()
+		{
+			orbit.prepare(SampleRate, BlockSize);
+			uniBuf.prepare(SampleRate, BlockSize);
+			delays.prepare(SampleRate, BlockSize, NumChannels, MaxTimeMs, sharedHistory, storage);
+			seedPlanets(orbit, seed);
+		}
+
+		// returns the seconds the delays took
+		double operator()(float** samples, int numPlanets, Interpolation type = Interpolation::Hermite,
+			workers::Pool* pool = nullptr) noexcept
+		{
+			orbit.processBlock(uniBuf, BlockSize, numPlanets);
+			const auto maxTime = delays.updateMaxTime(MaxTimeMs, BlockSize);
+			uniBuf.makeSmooth(maxTime, 1.f, BlockSize, numPlanets, delays.isMaxTimeConst());
+
+			const auto start = Clock::now();
+			delays(samples, uniBuf, 1.f / std::sqrt(static_cast<float>(numPlanets)), numPlanets, NumChannels, BlockSize,
+				type, pool);
+			return getSeconds(start);
+		}
+
+		Orbit orbit;
+		UniBuf uniBuf;
+		Delays delays;
+	};
+
+	namespace reference
+	{
+		/*
+		* the per-planet delays the engine replaced, as they were: every planet filters
+		* its own copy of the input, which the processor sums and scales afterwards
+		*/
+		struct WriteHead
+		{
+			void prepare(int blockSize)
+			{
+				buffer.resize(blockSize, 0);
+			}
+
+			void operator()(int numSamples, int ringBufferSize) noexcept
+			{
+				for (auto s = 0; s < numSamples; ++s)
+				{
+					++wHead;
+					if (wHead == ringBufferSize)
+						wHead = 0;
+					buffer[s] = wHead;
+				}
+			}
+
+			std::vector<int> buffer;
+			int wHead = -1;
+		};
+
+		inline float cubicHermiteSpline(const float* buffer, float readHead, int size) noexcept
+		{
+			const auto iFloor = std::floor(readHead);
+			auto i1 = static_cast<int>(iFloor);
+			auto i0 = i1 - 1;
+			auto i2 = i1 + 1;
+			auto i3 = i1 + 2;
+			if (i3 >= size) i3 -= size;
+			if (i2 >= size) i2 -= size;
+			if (i0 < 0) i0 += size;
+
+			const auto t = readHead - iFloor;
+			const auto v0 = buffer[i0];
+			const auto v1 = buffer[i1];
+			const auto v2 = buffer[i2];
+			const auto v3 = buffer[i3];
+
+			const auto c0 = v1;
+			const auto c1 = .5f * (v2 - v0);
+			const auto c2 = v0 - 2.5f * v1 + 2.f * v2 - .5f * v3;
+			const auto c3 = 1.5f * (v1 - v2) + .5f * (v3 - v0);
+
+			return ((c3 * t + c2) * t + c1) * t + c0;
+		}
+
+		using Samples = std::array<std::array<std::vector<float>, NumChannels>, NumPlanetsMacro>;
+
+		struct Delays
+		{
+			void prepare(double sampleRate, int blockSize)
+			{
+				wHead.prepare(blockSize);
+				ringBufferSize = static_cast<int>(sampleRate * MaxTimeMs * .001);
+				for (auto& delay : rings)
+					for (auto& ring : delay)
+						ring.assign(ringBufferSize + 4, 0.f);
+			}
+
+			void operator()(Samples& samples, const UniBuf& uniBuf, int numPlanets, int numSamples) noexcept
+			{
+				wHead(numSamples, ringBufferSize);
+				for (auto p = 0; p < numPlanets; ++p)
+				{
+					const auto phaseBuf = uniBuf[p].getPhaseBuf();
+					const auto magBuf = uniBuf[p].getMagBuf();
+					for (auto ch = 0; ch < NumChannels; ++ch)
+					{
+						auto ring = rings[p][ch].data();
+						auto smpls = samples[p][ch].data();
+						for (auto s = 0; s < numSamples; ++s)
+						{
+							const auto w = wHead.buffer[s];
+							auto r = static_cast<float>(w) - phaseBuf[s];
+							if (r < 0.f)
+								r += static_cast<float>(ringBufferSize);
+							const auto sOut = cubicHermiteSpline(ring, r, ringBufferSize);
+							ring[w] = smpls[s] * -magBuf[s];
+							smpls[s] = sOut;
+						}
+					}
+				}
+			}
+
+			WriteHead wHead;
+			std::array<std::array<std::vector<float>, NumChannels>, NumPlanetsMacro> rings;
+			int ringBufferSize = 1;
+		};
+
+		/********** struct Chain **********/
+		struct Chain
+		{
+			Chain(unsigned seed) :
+				orbit(11)
+			{
+				orbit.prepare(SampleRate, BlockSize);
+				uniBuf.prepare(SampleRate, BlockSize);
+				delays.prepare(SampleRate, BlockSize);
+				span.assign(BlockSize, static_cast<float>(delays.ringBufferSize));
+				for (auto& planet : audioBufs)
+					for (auto& buf : planet)
+						buf.assign(BlockSize, 0.f);
+				seedPlanets(orbit, seed);
+			}
+
+			// returns the seconds the copies, the delays and the sum took
+			double operator()(float** samples, int numPlanets) noexcept
+			{
+				orbit.processBlock(uniBuf, BlockSize, numPlanets);
+				uniBuf.makeSmooth(span.data(), 1.f, BlockSize, numPlanets);
+
+				const auto start = Clock::now();
+				for (auto& planet : audioBufs)
+					for (auto ch = 0; ch < NumChannels; ++ch)
+						std::copy(samples[ch], samples[ch] + BlockSize, planet[ch].data());
+				delays(audioBufs, uniBuf, numPlanets, BlockSize);
+				for (auto ch = 0; ch < NumChannels; ++ch)
+				{
+					std::copy(audioBufs[0][ch].begin(), audioBufs[0][ch].end(), samples[ch]);
+					for (auto p = 1; p < numPlanets; ++p)
+						juce::FloatVectorOperations::add(samples[ch], audioBufs[p][ch].data(), BlockSize);
+					juce::FloatVectorOperations::multiply(samples[ch], 1.f / std::sqrt(static_cast<float>(numPlanets)), BlockSize);
+				}
+				return getSeconds(start);
+			}
+
+			Orbit orbit;
+			UniBuf uniBuf;
+			Delays delays;
+			std::vector<float> span;
+			Samples audioBufs;
+		};
+	}
+
+	void benchMultiTap()
+	{
+		std::printf("planets  reference ns/smpl  multitap ns/smpl  speedup\n");
+		for (auto numPlanets : { 2, 4, 8, 13, 16, 24 })
+		{
+			auto ref = std::make_unique<reference::Chain>(7);
+			auto chain = std::make_unique<Chain>(7);
+			Stereo a, b;
+			auto tRef = 0., tNew = 0.;
+			for (auto blk = 0; blk < NumBlocks; ++blk)
+			{
+				tRef += (*ref)(a.fill(blk), numPlanets);
+				tNew += (*chain)(b.fill(blk), numPlanets);
+			}
+			std::printf("%7d  %17.1f  %16.1f  %6.2fx\n", numPlanets, toNsPerSample(tRef), toNsPerSample(tNew), tRef / tNew);
+		}
+	}
+
+	static constexpr const char* InterpolationNames[] = { "linear", "hermite", "lagrange4", "lagrange6", "allpass", "sinc16" };
+
+	/*
+	* one still planet delays a sine by a fixed fraction. returns the rms error of the second
+	* half against the ideally delayed sine, in dB relative to the sine, passband droop included
+	*/
+	double measureInterpolationError(Interpolation type, double freq)
+	{
+		static constexpr float Span = 1000.f;
+		static constexpr double Tau = 6.283185307179586;
+		auto uniBuf = std::make_unique<UniBuf>();
+		auto delays = std::make_unique<Delays>();
+		uniBuf->prepare(SampleRate, BlockSize);
+		delays->prepare(SampleRate, BlockSize, NumChannels, MaxTimeMs);
+
+		// delay = Span * (.5 cos(angle^2) + .5), about 100.37 frames
+		orbit::Planet<float> planet;
+		planet.angle = std::sqrt(std::acos(2.f * 100.37f / Span - 1.f));
+		planet.mag = 1.f;
+		const std::vector<float> maxTime(BlockSize, Span);
+
+		// long enough for the phase smoother to settle
+		const auto numBlocks = 400;
+		Stereo x;
+		auto err = 0., sig = 0.;
+		for (auto b = 0; b < numBlocks; ++b)
+		{
+			uniBuf->update(planet, 0, 0, BlockSize);
+			uniBuf->makeSmooth(maxTime.data(), 1.f, BlockSize, 1, true);
+			const auto delay = static_cast<double>((*uniBuf)[0].getPhaseBuf()[0]) + Delays::Engine::ReadOffset;
+			for (auto s = 0; s < BlockSize; ++s)
+				x.bufs[0][s] = x.bufs[1][s] = static_cast<float>(std::sin(Tau * freq
+					* (b * BlockSize + s) / SampleRate));
+			(*delays)(x.ptrs.data(), *uniBuf, 1.f, 1, NumChannels, BlockSize, type);
+			if (b < numBlocks / 2)
+				continue;
+			const auto mag = static_cast<double>((*uniBuf)[0].getMagBuf()[0]);
+			for (auto s = 0; s < BlockSize; ++s)
+			{
+				const auto n = static_cast<double>(b * BlockSize + s);
+				const auto y = -mag * std::sin(Tau * freq * (n - delay) / SampleRate);
+				err += (x.bufs[0][s] - y) * (x.bufs[0][s] - y);
+				sig += y * y;
+			}
+		}
+		return 10. * std::log10(err / sig);
+	}
+
+	void benchInterpolation()
+	{
+		std::printf("type       ns/tap  err 1 kHz  err 5 kHz  err 15 kHz\n");
+		for (auto i = 0; i < static_cast<int>(Interpolation::NumTypes); ++i)
+		{
+			const auto type = static_cast<Interpolation>(i);
+			auto chain = std::make_unique<Chain>(1);
+			Stereo x;
+			auto t = 0.;
+			for (auto b = 0; b < NumBlocks; ++b)
+				t += (*chain)(x.fill(b), NumPlanetsMacro, type);
+			std::printf("%-9s  %6.2f  %6.1f dB  %6.1f dB  %7.1f dB\n", InterpolationNames[i], toNsPerSample(t) / NumPlanetsMacro,
+				measureInterpolationError(type, 1000.), measureInterpolationError(type, 5000.), measureInterpolationError(type, 15000.));
+		}
+	}
+
+	void benchStorage()
+	{
+		std::printf("history     storage  error rel. float  float ns/smpl  compact ns/smpl\n");
+		for (auto sharedHistory : { false, true })
+			for (auto storage : { Storage::Half, Storage::Int16 })
+			{
+				auto ref = std::make_unique<Chain>(7, sharedHistory);
+				auto compact = std::make_unique<Chain>(7, sharedHistory, storage);
+				Stereo a, b;
+				auto tRef = 0., tCompact = 0., err = 0., sig = 0.;
+				for (auto blk = 0; blk < NumBlocks; ++blk)
+				{
+					tRef += (*ref)(a.fill(blk), NumPlanetsMacro);
+					tCompact += (*compact)(b.fill(blk), NumPlanetsMacro);
+					for (auto ch = 0; ch < NumChannels; ++ch)
+						for (auto s = 0; s < BlockSize; ++s)
+						{
+							const auto d = static_cast<double>(a.bufs[ch][s] - b.bufs[ch][s]);
+							err += d * d;
+							sig += static_cast<double>(a.bufs[ch][s]) * a.bufs[ch][s];
+						}
+				}
+				std::printf("%-10s  %-7s  %13.1f dB  %13.1f  %15.1f\n", sharedHistory ? "shared" : "per-planet",
+					storage == Storage::Half ? "half" : "int16", 10. * std::log10(err / sig), toNsPerSample(tRef), toNsPerSample(tCompact));
+			}
+	}
+
+	// the planets, their modulation and the delays at the oversampled rate, as processBlock runs them
+	void benchOversampling()
+	{
+		std::printf("factor  total ns/smpl  filters ns/smpl  filters share\n");
+		for (auto order = 0; order <= oversampling::MaxOrder; ++order)
+		{
+			oversampling::Oversampler<float> oversampler;
+			oversampler.prepare(BlockSize, order, NumChannels);
+			const auto factor = oversampler.getFactor();
+			const auto sampleRateUp = SampleRate * static_cast<float>(factor);
+			const auto blockSizeUp = BlockSize * factor;
+
+			auto planets = std::make_unique<Orbit>(11);
+			auto uniBuf = std::make_unique<UniBuf>();
+			auto delays = std::make_unique<Delays>();
+			planets->prepare(sampleRateUp, blockSizeUp, order);
+			uniBuf->prepare(sampleRateUp, blockSizeUp);
+			delays->prepare(sampleRateUp, blockSizeUp, NumChannels, MaxTimeMs);
+			seedPlanets(*planets, 7);
+
+			Stereo x;
+			auto tFilters = 0., tTotal = 0.;
+			for (auto b = 0; b < NumBlocks; ++b)
+			{
+				const auto samples = x.fill(b);
+				const auto t0 = Clock::now();
+				auto samplesUp = samples;
+				if (order != 0)
+					samplesUp = oversampler.upsample(samples, NumChannels, BlockSize);
+				const auto t1 = Clock::now();
+				planets->processBlock(*uniBuf, blockSizeUp);
+				const auto maxTime = delays->updateMaxTime(MaxTimeMs, blockSizeUp);
+				uniBuf->makeSmooth(maxTime, 1.f, blockSizeUp, NumPlanetsMacro, delays->isMaxTimeConst());
+				(*delays)(samplesUp, *uniBuf, .2f, NumPlanetsMacro, NumChannels, blockSizeUp);
+				const auto t2 = Clock::now();
+				if (order != 0)
+					oversampler.downsample(samples, NumChannels, BlockSize);
+				tFilters += std::chrono::duration<double>((t1 - t0) + (Clock::now() - t2)).count();
+				tTotal += getSeconds(t0);
+			}
+			std::printf("%5dx  %13.1f  %15.1f  %12.1f%%\n", factor, toNsPerSample(tTotal), toNsPerSample(tFilters),
+				100. * tFilters / tTotal);
+		}
+	}
+
+	// returns the output of all blocks and the delays' time in ns/sample
+	std::vector<float> runPool(bool sharedHistory, int numThreads, double& nsPerSample, bool& parallel)
+	{
+		workers::Pool pool;
+		pool.prepare(numThreads);
+		auto chain = std::make_unique<Chain>(7, sharedHistory);
+		Stereo x;
+		std::vector<float> out;
+		out.reserve(NumBlocks * BlockSize * NumChannels);
+		auto t = 0.;
+		for (auto b = 0; b < NumBlocks; ++b)
+		{
+			t += (*chain)(x.fill(b), NumPlanetsMacro, Interpolation::Hermite, &pool);
+			for (const auto& buf : x.bufs)
+				out.insert(out.end(), buf.begin(), buf.end());
+		}
+		nsPerSample = toNsPerSample(t);
+		parallel = pool.isParallel();
+		return out;
+	}
+
+	void benchPool()
+	{
+		const auto numCpus = juce::SystemStats::getNumCpus();
+		std::printf("%d cpus. the pool uses at most as many threads, PlanetsPerJob %d\n", numCpus, Delays::Engine::PlanetsPerJob);
+		for (auto sharedHistory : { false, true })
+		{
+			std::printf("%s history\nthreads  ns/smpl  speedup  parallel at end  max diff\n", sharedHistory ? "shared" : "per-planet");
+			auto tSeq = 0.;
+			auto parallel = false;
+			const auto ref = runPool(sharedHistory, 1, tSeq, parallel);
+			for (auto numThreads = 1; numThreads <= workers::MaxThreads; ++numThreads)
+			{
+				auto t = 0.;
+				const auto out = runPool(sharedHistory, numThreads, t, parallel);
+				auto maxDif = 0.f;
+				for (size_t i = 0; i < out.size(); ++i)
+					maxDif = std::max(maxDif, std::abs(out[i] - ref[i]));
+				std::printf("%7d  %7.1f  %6.2fx  %15s  %8.2g\n", std::min(numThreads, numCpus), t, tSeq / t,
+					parallel ? "yes" : "no", maxDif);
+			}
+		}
+	}
+
+	// owns the parameters like the plugin does, without processing anything
+	struct ParamHost :
+		public juce::AudioProcessor
+	{
+		ParamHost() :
+			juce::AudioProcessor(),
+			params(*this)
+		{}
+
+		void prepareToPlay(double, int) override {}
+		void releaseResources() override {}
+		void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override {}
+		juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+		bool hasEditor() const override { return false; }
+		const juce::String getName() const override { return "ParamHost"; }
+		bool acceptsMidi() const override { return false; }
+		bool producesMidi() const override { return false; }
+		double getTailLengthSeconds() const override { return 0.; }
+		int getNumPrograms() override { return 1; }
+		int getCurrentProgram() override { return 0; }
+		void setCurrentProgram(int) override {}
+		const juce::String getProgramName(int) override { return {}; }
+		void changeProgramName(int, const juce::String&) override {}
+		void getStateInformation(juce::MemoryBlock&) override {}
+		void setStateInformation(const void*, int) override {}
+
+		param::Params params;
+	};
+
+	// the parameters a block reads, either straight from the atomics or from the snapshot
+	void benchSnapshot()
+	{
+		using param::PID;
+		static constexpr int NumReads = 1 << 20;
+		auto host = std::make_unique<ParamHost>();
+		auto& params = host->params;
+		param::Snapshot snapshot;
+		volatile float sink = 0.f;
+
+		// without the event queue an automated parameter is just its atomic, like the reads measured.
+		// the queue's cost doesn't depend on how the parameters are read
+		for (auto p = 0; p < param::NumParams; ++p)
+			params[p].setEventQueue(nullptr);
+		const auto automate = [&](int b)
+		{
+			for (auto p = 0; p < param::NumParams; ++p)
+				params[p].setValue(.3f + .4f * static_cast<float>((b + p) % 100) * .01f);
+		};
+
+		// the fastest of NumRuns, the automation alone is subtracted from both
+		static constexpr int NumRuns = 5;
+		const auto time = [&](bool automated, auto&& read)
+		{
+			auto best = 1e9;
+			for (auto r = 0; r < NumRuns; ++r)
+			{
+				const auto start = Clock::now();
+				for (auto b = 0; b < NumReads; ++b)
+				{
+					if (automated)
+						automate(b);
+					read();
+				}
+				best = std::min(best, getSeconds(start));
+			}
+			return best;
+		};
+
+		std::printf("parameters     per-call ns/block  snapshot ns/block\n");
+		for (auto automated : { false, true })
+		{
+			const auto tBase = time(automated, [] {});
+			const auto tPerCall = time(automated, [&]
+			{
+				sink = params[PID::Mix].getValue() + params[PID::StereoConfig].getValue() + params[PID::Gain].getValDenorm()
+					+ params[PID::NumPlanets].getValDenorm() + params[PID::Gravity].getValDenorm()
+					+ params[PID::SpaceMud].getValDenorm() + params[PID::Attraction].getValDenorm()
+					+ params[PID::MaxTime].getValDenorm() + params[PID::Depth].getValue()
+					+ params[PID::Interpolation].getValDenorm();
+			}) - tBase;
+			const auto tSnapshot = time(automated, [&]
+			{
+				snapshot.update(params);
+				sink = snapshot.getValue(PID::Mix) + snapshot.getValue(PID::StereoConfig) + snapshot.getValDenorm(PID::Gain)
+					+ snapshot.getValDenorm(PID::NumPlanets) + snapshot.getValDenorm(PID::Gravity)
+					+ snapshot.getValDenorm(PID::SpaceMud) + snapshot.getValDenorm(PID::Attraction)
+					+ snapshot.getValDenorm(PID::MaxTime) + snapshot.getValue(PID::Depth)
+					+ snapshot.getValDenorm(PID::Interpolation);
+				snapshot.clearChanges();
+			}) - tBase;
+			std::printf("%-13s  %17.1f  %17.1f\n", automated ? "all automated" : "static",
+				tPerCall * 1e9 / NumReads, tSnapshot * 1e9 / NumReads);
+		}
+
+		// dry/wet around silent planets, mix and gain changing every block or holding still
+		static constexpr int NumSamples = 1 << 22;
+		std::printf("\nblock size  moving ns/smpl  settled ns/smpl\n");
+		for (auto blockSize : { 128, BlockSize })
+		{
+			// the input is copied in every block, sine and cosine would cost more than dry/wet
+			Stereo input(blockSize), x(blockSize);
+			input.fill(0);
+			std::array<double, 2> t;
+			for (auto settled : { false, true })
+			{
+				drywet::Processor<float> dryWet;
+				dryWet.prepare(static_cast<float>(SampleRate), blockSize, NumChannels);
+				auto best = 1e9;
+				for (auto r = 0; r < NumRuns; ++r)
+				{
+					const auto start = Clock::now();
+					for (auto b = 0; b < NumSamples / blockSize; ++b)
+					{
+						const auto odd = !settled && (b & 1) != 0;
+						auto samples = x.ptrs.data();
+						for (auto ch = 0; ch < NumChannels; ++ch)
+							juce::FloatVectorOperations::copy(samples[ch], input.ptrs[ch], blockSize);
+						dryWet.saveDry(const_cast<const float**>(samples), odd ? .3f : .5f, NumChannels, NumChannels, blockSize);
+						for (auto ch = 0; ch < NumChannels; ++ch)
+							juce::FloatVectorOperations::clear(samples[ch], blockSize);
+						dryWet.processWet(samples, odd ? -6.f : -3.f, NumChannels, NumChannels, blockSize);
+					}
+					best = std::min(best, getSeconds(start));
+				}
+				t[settled ? 1 : 0] = best * 1e9 / NumSamples;
+			}
+			std::printf("%10d  %14.2f  %15.2f\n", blockSize, t[0], t[1]);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	struct Mode
+	{
+		const char* name;
+		void(*run)();
+	};
+	static constexpr Mode Modes[] =
+	{
+		{ "multitap", &benchMultiTap },
+		{ "interpolation", &benchInterpolation },
+		{ "storage", &benchStorage },
+		{ "oversampling", &benchOversampling },
+		{ "pool", &benchPool },
+		{ "snapshot", &benchSnapshot }
+	};
+
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: Bench multitap|interpolation|storage|oversampling|pool|snapshot\n");
+		return 1;
+	}
+	for (const auto& mode : Modes)
+		if (std::strcmp(argv[1], mode.name) == 0)
+		{
+			// the widest kernels, as prepareToPlay picks them by default
+			const auto isa = simd::detect();
+			simd::select(isa);
+			std::printf("%s kernels\n", simd::toString(isa).toRawUTF8());
+			mode.run();
+			return 0;
+		}
+	std::fprintf(stderr, "unknown mode %s\n", argv[1]);
+	return 1;
+}
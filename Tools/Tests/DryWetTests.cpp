@@ -0,0 +1,121 @@
+#include <cmath>
+#include <array>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include "DryWetProcessor.h"
+#include "Oversampling.h"
+
+namespace
+{
+	/********** struct DryWetSilenceTest **********/
+	/*
+	* the chain sleeps on a silent input once the delays rang out. the dry signal has to
+	* go on through the oversampler's latency as if the planets were awake with a silent wet signal
+	*/
+	struct DryWetSilenceTest :
+		public juce::UnitTest
+	{
+		static constexpr float SampleRate = 48000.f;
+		// the processor's SubBlockSize at the planets' rate
+		static constexpr int SubBlockSize = 128;
+		static constexpr int NumChannels = 2;
+		// long enough for mix and gain to settle
+		static constexpr int WarmUp = 1 << 15;
+		static constexpr float Mix = .5f;
+
+		DryWetSilenceTest() :
+			juce::UnitTest("DryWet silence", "DryWet")
+		{}
+
+		void runTest() override
+		{
+			for (auto order = 1; order <= oversampling::MaxOrder; ++order)
+			{
+				beginTest("burst, silence, audio at " + juce::String(1 << order) + "x oversampling");
+
+				const auto blockSize = SubBlockSize >> order;
+				oversampling::Oversampler<float> oversampler;
+				oversampler.prepare(blockSize, order, NumChannels);
+				const auto latency = oversampler.getLatency();
+				expectGreaterThan(latency, 0);
+
+				drywet::Processor<float> awake, sleeping;
+				awake.prepare(SampleRate, blockSize, NumChannels, latency);
+				sleeping.prepare(SampleRate, blockSize, NumChannels, latency);
+
+				// burst -> silence -> audio. the burst ends less than the latency before a sub-block
+				const auto input = makeInput(blockSize * 9 - 5, blockSize * 7 + 3, blockSize * 8);
+				const auto numSamples = static_cast<int>(input[0].size());
+				auto outAwake = input, outSleeping = input;
+				auto numSlept = 0;
+				for (auto s = 0; s < numSamples; s += blockSize)
+				{
+					const auto n = std::min(blockSize, numSamples - s);
+					std::array<float*, NumChannels> a, b;
+					for (auto ch = 0; ch < NumChannels; ++ch)
+					{
+						a[ch] = outAwake[ch].data() + s;
+						b[ch] = outSleeping[ch].data() + s;
+					}
+					processAwake(awake, a.data(), n);
+					if (s >= WarmUp && isSilent(b.data(), n))
+					{
+						sleeping.processSilence(b.data(), Mix, 0.f, NumChannels, NumChannels, n);
+						++numSlept;
+					}
+					else
+						processAwake(sleeping, b.data(), n);
+				}
+				expectGreaterThan(numSlept, 2, "the silence spans whole sub-blocks");
+
+				const auto dryGain = std::sqrt(1.f - Mix);
+				auto maxDifAwake = 0.f, maxDifDry = 0.f;
+				for (auto ch = 0; ch < NumChannels; ++ch)
+					for (auto s = WarmUp; s < numSamples; ++s)
+					{
+						const auto dry = input[ch][s - latency] * dryGain;
+						maxDifAwake = std::max(maxDifAwake, std::abs(outSleeping[ch][s] - outAwake[ch][s]));
+						maxDifDry = std::max(maxDifDry, std::abs(outSleeping[ch][s] - dry));
+					}
+				expectEquals(maxDifAwake, 0.f, "sleeping matches the awake chain");
+				expectLessThan(maxDifDry, 1e-6f, "the output is the input delayed by the latency");
+			}
+		}
+
+		// silence to let the smoothers settle, then a burst, a silence and audio again
+		static std::array<std::vector<float>, NumChannels> makeInput(int burst, int silence, int audio)
+		{
+			std::array<std::vector<float>, NumChannels> input;
+			for (auto ch = 0; ch < NumChannels; ++ch)
+			{
+				auto& x = input[ch];
+				x.assign(WarmUp + burst + silence + audio, 0.f);
+				for (auto s = 0; s < burst; ++s)
+					x[WarmUp + s] = .5f * std::sin(.05f * static_cast<float>(s * (ch + 1)));
+				for (auto s = 0; s < audio; ++s)
+					x[WarmUp + burst + silence + s] = .25f * std::cos(.03f * static_cast<float>(s * (ch + 2)));
+			}
+			return input;
+		}
+
+		// what the chain does while awake, where the delays return silence
+		static void processAwake(drywet::Processor<float>& dryWet, float** samples, int numSamples)
+		{
+			dryWet.saveDry(const_cast<const float**>(samples), Mix, NumChannels, NumChannels, numSamples);
+			for (auto ch = 0; ch < NumChannels; ++ch)
+				juce::FloatVectorOperations::clear(samples[ch], numSamples);
+			dryWet.processWet(samples, 0.f, NumChannels, NumChannels, numSamples);
+		}
+
+		static bool isSilent(float* const* samples, int numSamples)
+		{
+			for (auto ch = 0; ch < NumChannels; ++ch)
+				for (auto s = 0; s < numSamples; ++s)
+					if (samples[ch][s] != 0.f)
+						return false;
+			return true;
+		}
+	};
+
+	static DryWetSilenceTest dryWetSilenceTest;
+}
@@ -0,0 +1,137 @@
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include "Orbit.h"
+
+namespace
+{
+	/********** struct SincEdgeTest **********/
+	/*
+	* MultiTap turns a whole-number delay into t == 1, every padded lane of a group
+	* (phase 0, delay ReadOffset) reads that way. the sinc weights have to come from
+	* the table's last row then, not from the one past it
+	*/
+	struct SincEdgeTest :
+		public juce::UnitTest
+	{
+		static constexpr int Lanes = 8;
+		static constexpr float SampleRate = 48000.f;
+		static constexpr int BlockSize = 128;
+		// long enough for the phase smoother to settle
+		static constexpr int NumBlocks = 800;
+		static constexpr int NumPlanets = 3;
+		static constexpr int NumChannels = 2;
+		static constexpr float Span = 1000.f;
+
+		using Sinc = orbit::interpolation::Sinc16<float>;
+		using Lane = std::array<float, Lanes>;
+		using Weights = std::array<Lane, orbit::interpolation::MaxPoints>;
+		using UniBuf = orbit::UniversalBuffer<float, NumPlanets>;
+		using Delays = orbit::ResizingMultiTap<float, NumPlanets>;
+
+		SincEdgeTest() :
+			juce::UnitTest("Sinc interpolation edges", "Orbit")
+		{}
+
+		void runTest() override
+		{
+			beginTest("weights at t == 1 are the table's last row");
+			{
+				const auto w = getWeights(1.f);
+				const auto below = getWeights(std::nextafter(1.f, 0.f));
+				const auto last = Sinc::Table::getInstance().getPhase(Sinc::Table::NumPhases);
+				auto sum = 0.f, maxDifLast = 0.f, maxDifBelow = 0.f;
+				for (auto k = 0; k < Sinc::NumPoints; ++k)
+				{
+					expect(std::isfinite(w[k][0]), "weight " + juce::String(k));
+					sum += w[k][0];
+					maxDifLast = std::max(maxDifLast, std::abs(w[k][0] - last[k]));
+					maxDifBelow = std::max(maxDifBelow, std::abs(w[k][0] - below[k][0]));
+				}
+				expectWithinAbsoluteError(sum, 1.f, 1e-5f);
+				expectWithinAbsoluteError(maxDifLast, 0.f, 1e-6f);
+				expectWithinAbsoluteError(maxDifBelow, 0.f, 1e-4f);
+			}
+
+			beginTest("whole-number delays read t as MultiTap computes it");
+			{
+				for (auto d : { 7.f, 8.f, 100.f, 1919.f })
+				{
+					const auto t = 1.f - (d - std::floor(d));
+					expectEquals(t, 1.f);
+					const auto w = getWeights(t);
+					const auto ref = getWeights(1.f);
+					for (auto k = 0; k < Sinc::NumPoints; ++k)
+						expectEquals(w[k][0], ref[k][0], "delay " + juce::String(d) + ", weight " + juce::String(k));
+				}
+			}
+
+			beginTest("a still planet and the padded lanes delay through the sinc");
+			{
+				// delay = Span * (.5 cos(angle^2) + .5), so angle^2 = pi puts the planet at the read offset
+				auto uniBuf = std::make_unique<UniBuf>();
+				auto delays = std::make_unique<Delays>();
+				uniBuf->prepare(SampleRate, BlockSize);
+				delays->prepare(SampleRate, BlockSize, NumChannels, 40.f);
+				orbit::Planet<float> planet;
+				planet.angle = std::sqrt(3.14159265359f);
+				planet.mag = 1.f;
+				const std::vector<float> maxTime(BlockSize, Span);
+
+				std::array<std::vector<float>, NumChannels> bufs;
+				std::array<float*, NumChannels> ptrs;
+				for (auto ch = 0; ch < NumChannels; ++ch)
+				{
+					bufs[ch].assign(BlockSize, 0.f);
+					ptrs[ch] = bufs[ch].data();
+				}
+
+				auto finite = true;
+				auto maxErr = 0.;
+				for (auto b = 0; b < NumBlocks; ++b)
+				{
+					uniBuf->update(planet, 0, 0, BlockSize);
+					uniBuf->makeSmooth(maxTime.data(), 1.f, BlockSize, 1, true);
+					for (auto ch = 0; ch < NumChannels; ++ch)
+						for (auto s = 0; s < BlockSize; ++s)
+							bufs[ch][s] = getInput(ch, b * BlockSize + s);
+					(*delays)(ptrs.data(), *uniBuf, 1.f, 1, NumChannels, BlockSize, orbit::interpolation::Type::Sinc);
+
+					const auto phase = (*uniBuf)[0].getPhaseBuf();
+					const auto mag = (*uniBuf)[0].getMagBuf();
+					for (auto ch = 0; ch < NumChannels; ++ch)
+						for (auto s = 0; s < BlockSize; ++s)
+						{
+							finite = finite && std::isfinite(bufs[ch][s]);
+							if (b < NumBlocks / 2)
+								continue;
+							const auto delay = static_cast<double>(phase[s]) + Delays::Engine::ReadOffset;
+							const auto y = -static_cast<double>(mag[s]) * getInput(ch, static_cast<double>(b * BlockSize + s) - delay);
+							maxErr = std::max(maxErr, std::abs(bufs[ch][s] - y));
+						}
+				}
+				expect(finite);
+				expectWithinAbsoluteError(maxErr, 0., 1e-4);
+			}
+		}
+
+		static Weights getWeights(float t)
+		{
+			Lane lane, feedback;
+			lane.fill(t);
+			Weights w;
+			Sinc::weights<Lanes>(lane, w, feedback);
+			return w;
+		}
+
+		// a 1 kHz sine, the sinc's error is far below the tolerance there
+		static double getInput(int ch, double n)
+		{
+			return .5 * std::sin(6.283185307179586 * 1000. * n / SampleRate + static_cast<double>(ch));
+		}
+	};
+
+	static SincEdgeTest sincEdgeTest;
+}
@@ -0,0 +1,27 @@
+/*
+* Unit tests of the code in Source/ that runs without a host.
+* Every *Tests.cpp next to this file registers its juce::UnitTest instances,
+* main runs all of them and fails if any expectation did.
+*
+* build: c++ -std=c++20 -O2 -DNumPlanetsMacro=24 -DJUCE_GLOBAL_MODULE_SETTINGS_INCLUDED=1 -DJUCE_STANDALONE_APPLICATION=1
+*        -I../../Source -I$JUCE/modules *.cpp
+*        $JUCE/modules/juce_core/juce_core.cpp $JUCE/modules/juce_events/juce_events.cpp
+*        $JUCE/modules/juce_data_structures/juce_data_structures.cpp $JUCE/modules/juce_graphics/juce_graphics.cpp
+*        $JUCE/modules/juce_gui_basics/juce_gui_basics.cpp $JUCE/modules/juce_gui_extra/juce_gui_extra.cpp
+*        $JUCE/modules/juce_audio_basics/juce_audio_basics.cpp $JUCE/modules/juce_audio_processors/juce_audio_processors.cpp
+*        -lpthread -ldl -lfreetype -o Tests
+* usage: Tests
+*/
+
+#include <juce_core/juce_core.h>
+
+int main()
+{
+	juce::UnitTestRunner runner;
+	runner.runAllTests();
+
+	auto failures = 0;
+	for (auto i = 0; i < runner.getNumResults(); ++i)
+		failures += runner.getResult(i)->failures;
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#include <array>
+#include <vector>
+#include <juce_core/juce_core.h>
+#include "Orbit.h"
+
+namespace
+{
+	/********** struct ModulationVariantsTest **********/
+	/*
+	* the constant span and settled phase variants of the modulation skip work the
+	* general path does per sample. their output has to stay bit-identical to it
+	*/
+	struct ModulationVariantsTest :
+		public juce::UnitTest
+	{
+		static constexpr float SampleRate = 48000.f;
+		static constexpr int BlockSize = 128;
+		// long enough for the phase smoother (120 ms) to settle
+		static constexpr int NumBlocks = 2400;
+		static constexpr int NumPlanets = 3;
+		static constexpr float Span = 1234.5f;
+
+		using Celest = orbit::CelestialBuffer<float>;
+		using UniBuf = orbit::UniversalBuffer<float, NumPlanets>;
+
+		ModulationVariantsTest() :
+			juce::UnitTest("Modulation variants", "Orbit")
+		{}
+
+		void runTest() override
+		{
+			beginTest("CelestialBuffer variants match the forced general path");
+			{
+				// p: 0 keeps still, 1 moves throughout, 2 stops a quarter in
+				for (auto p = 0; p < NumPlanets; ++p)
+				{
+					std::array<Celest, 3> variants;
+					Celest general;
+					for (auto& celest : variants)
+						celest.prepare(SampleRate, BlockSize);
+					general.prepare(SampleRate, BlockSize);
+					const std::vector<float> span(BlockSize, Span);
+
+					auto maxDif = 0.f;
+					for (auto b = 0; b < NumBlocks; ++b)
+					{
+						const auto planet = makePlanet(p, b);
+						for (auto& celest : variants)
+							celest.update(planet, 0, BlockSize);
+						general.update(planet, 0, BlockSize);
+
+						variants[0].makeSmooth<true>(span.data(), BlockSize);
+						variants[1].makeSmooth<false>(span.data(), BlockSize);
+						variants[2].makeSmooth<true, false>(span.data(), BlockSize);
+						general.makeSmooth<false, false>(span.data(), BlockSize);
+						for (const auto& celest : variants)
+							maxDif = std::max(maxDif, getMaxDif(celest, general));
+					}
+					expectEquals(maxDif, 0.f, "planet " + juce::String(p));
+				}
+			}
+
+			beginTest("a slow smoother settles where float rounding stalls its ramp");
+			{
+				// the phase smoother a few ulps below a planet's phase. a block moves it by less than half an ulp
+				orbit::Smooth<float> smooth;
+				std::vector<float> buf;
+				orbit::prepareParam(smooth, buf, 120.f, SampleRate, BlockSize);
+				const auto target = 4.4253101f;
+				smooth.setValue(target - 8e-6f);
+				auto settled = false;
+				for (auto b = 0; b < NumBlocks && !settled; ++b)
+					settled = smooth(buf.data(), target, BlockSize);
+				expect(settled, "so the settled variants can run");
+			}
+
+			beginTest("UniversalBuffer constant span matches the general span");
+			{
+				UniBuf constSpan, general;
+				constSpan.prepare(SampleRate, BlockSize);
+				general.prepare(SampleRate, BlockSize);
+				const std::vector<float> maxTime(BlockSize, Span);
+
+				auto maxDif = 0.f;
+				for (auto b = 0; b < NumBlocks; ++b)
+				{
+					for (auto p = 0; p < NumPlanets; ++p)
+					{
+						const auto planet = makePlanet(p, b);
+						constSpan.update(planet, p, 0, BlockSize);
+						general.update(planet, p, 0, BlockSize);
+					}
+					// Depth moves once, so the blocks around it take the general path either way
+					const auto depth = b < NumBlocks / 3 ? .7f : .4f;
+					constSpan.makeSmooth(maxTime.data(), depth, BlockSize, NumPlanets, true);
+					general.makeSmooth(maxTime.data(), depth, BlockSize, NumPlanets, false);
+					for (auto p = 0; p < NumPlanets; ++p)
+						maxDif = std::max(maxDif, getMaxDif(constSpan[p], general[p]));
+				}
+				expectEquals(maxDif, 0.f);
+			}
+		}
+
+		static orbit::Planet<float> makePlanet(int p, int b)
+		{
+			const auto t = p == 0 ? 0 : p == 1 ? b : std::min(b, NumBlocks / 4);
+			orbit::Planet<float> planet;
+			planet.pos = { .2f + .01f * static_cast<float>(p), -.3f };
+			planet.angle = .4f + .003f * static_cast<float>(t);
+			planet.mag = .0001f * (1.f + .5f * std::sin(.01f * static_cast<float>(t)));
+			return planet;
+		}
+
+		static float getMaxDif(const Celest& a, const Celest& b)
+		{
+			auto maxDif = 0.f;
+			for (auto s = 0; s < BlockSize; ++s)
+			{
+				maxDif = std::max(maxDif, std::abs(a.getPhaseBuf()[s] - b.getPhaseBuf()[s]));
+				maxDif = std::max(maxDif, std::abs(a.getMagBuf()[s] - b.getMagBuf()[s]));
+			}
+			return maxDif;
+		}
+	};
+
+	static ModulationVariantsTest modulationVariantsTest;
+}
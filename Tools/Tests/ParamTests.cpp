@@ -0,0 +1,135 @@
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <juce_core/juce_core.h>
+#include "Param.h"
+
+namespace
+{
+	using param::PID;
+
+	// owns the parameters like the plugin does, without processing anything
+	struct ParamHost :
+		public juce::AudioProcessor
+	{
+		ParamHost() :
+			juce::AudioProcessor(),
+			params(*this)
+		{}
+
+		void prepareToPlay(double, int) override {}
+		void releaseResources() override {}
+		void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override {}
+		juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+		bool hasEditor() const override { return false; }
+		const juce::String getName() const override { return "ParamHost"; }
+		bool acceptsMidi() const override { return false; }
+		bool producesMidi() const override { return false; }
+		double getTailLengthSeconds() const override { return 0.; }
+		int getNumPrograms() override { return 1; }
+		int getCurrentProgram() override { return 0; }
+		void setCurrentProgram(int) override {}
+		const juce::String getProgramName(int) override { return {}; }
+		void changeProgramName(int, const juce::String&) override {}
+		void getStateInformation(juce::MemoryBlock&) override {}
+		void setStateInformation(const void*, int) override {}
+
+		param::Params params;
+	};
+
+	// runs block b of numBlocks on thread b % 2, one after the other, like a host that rotates pool threads
+	template<typename Func>
+	void alternate(int numBlocks, Func&& func)
+	{
+		std::atomic<int> turn{ 0 };
+		const auto run = [&](int t)
+		{
+			for (auto b = t; b < numBlocks; b += 2)
+			{
+				while (turn.load() != b)
+					std::this_thread::yield();
+				func(b);
+				turn.store(b + 1);
+			}
+		};
+		std::thread a(run, 0), b(run, 1);
+		a.join();
+		b.join();
+	}
+
+	/********** struct AutomationTest **********/
+	struct AutomationTest :
+		public juce::UnitTest
+	{
+		// a low rate, so a block period of a few ms is far from the host pausing
+		static constexpr double SampleRate = 1000.;
+		static constexpr int NumSamples = 512;
+		static constexpr int NumBlocks = 16;
+
+		AutomationTest() :
+			juce::UnitTest("Automation", "Param")
+		{}
+
+		void runTest() override
+		{
+			beginTest("changes between blocks apply at their start on alternating threads");
+			{
+				ParamHost host;
+				auto& params = host.params;
+				param::Snapshot snapshot;
+				param::Automation automation;
+				automation.prepare(SampleRate);
+				alternate(NumBlocks, [&](int b)
+				{
+					const auto val = static_cast<float>(b) / static_cast<float>(NumBlocks);
+					params[PID::Mix].setValue(val);
+					const auto complete = automation.beginBlock(params.getEvents(), NumSamples);
+					if (!complete)
+						snapshot.update(params);
+					const auto next = automation.apply(snapshot, params, 0, NumSamples);
+					if (b != 0)
+					{
+						expect(complete, "no change is dropped");
+						expectEquals(next, NumSamples, "nothing is left for later in the block");
+					}
+					expectEquals(snapshot.getValue(PID::Mix), val, "the block starts with the change");
+					automation.endBlock(params.getEvents());
+				});
+			}
+
+			beginTest("changes while a block runs keep their offset on alternating threads");
+			{
+				ParamHost host;
+				auto& params = host.params;
+				param::Snapshot snapshot;
+				param::Automation automation;
+				automation.prepare(SampleRate);
+				alternate(NumBlocks, [&](int b)
+				{
+					const auto val = static_cast<float>(b) / static_cast<float>(NumBlocks);
+					if (!automation.beginBlock(params.getEvents(), NumSamples))
+						snapshot.update(params);
+					const auto offset = automation.apply(snapshot, params, 0, NumSamples);
+					if (b > 1)
+					{
+						expectGreaterThan(offset, 0, "the change isn't moved to the start");
+						expectLessThan(offset, NumSamples, "the change isn't moved past the block");
+						const auto prev = static_cast<float>(b - 1) / static_cast<float>(NumBlocks);
+						expect(snapshot.getValue(PID::Mix) != prev, "the change isn't applied early");
+						expectEquals(automation.apply(snapshot, params, offset, NumSamples), NumSamples);
+						expectEquals(snapshot.getValue(PID::Mix), prev, "the change is applied at its offset");
+					}
+
+					// the editor changes Mix halfway through the block
+					std::this_thread::sleep_for(std::chrono::milliseconds(10));
+					std::thread editor([&]() { params[PID::Mix].setValue(val); });
+					editor.join();
+					std::this_thread::sleep_for(std::chrono::milliseconds(10));
+					automation.endBlock(params.getEvents());
+				});
+			}
+		}
+	};
+
+	static AutomationTest automationTest;
+}
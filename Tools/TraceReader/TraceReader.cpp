@@ -0,0 +1,124 @@
+/*
+* Converts a NELOrbit modulation trace (.nelt, see Source/Trace.h) to CSV.
+* One row per sample: samplePos, timeSecs (of the block), numDropped, numActiveTaps, phase0..N-1, mag0..N-1
+* numActiveTaps is only recorded since version 2 and left empty for older traces.
+* Planets that were inactive in a block are left empty.
+*
+* build: c++ -std=c++17 -O2 TraceReader.cpp -o TraceReader
+* usage: TraceReader trace.nelt [out.csv]
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	template<typename T>
+	bool read(std::ifstream& file, T& val)
+	{
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(&val), sizeof(T)));
+	}
+
+	bool read(std::ifstream& file, std::vector<float>& buf, size_t size)
+	{
+		buf.resize(size);
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(buf.data()), size * sizeof(float)));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: TraceReader trace.nelt [out.csv]\n";
+		return 1;
+	}
+
+	std::ifstream file(argv[1], std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "can't open " << argv[1] << "\n";
+		return 1;
+	}
+
+	char magic[4];
+	int32_t version, maxPlanets, maxBlockSize;
+	double sampleRate;
+	if (!file.read(magic, 4) || std::memcmp(magic, "NELT", 4) != 0
+		|| !read(file, version) || !read(file, sampleRate)
+		|| !read(file, maxPlanets) || !read(file, maxBlockSize))
+	{
+		std::cerr << "not a NELOrbit trace\n";
+		return 1;
+	}
+	if (version < 1 || version > 2)
+	{
+		std::cerr << "unsupported trace version " << version << "\n";
+		return 1;
+	}
+
+	FILE* out = argc > 2 ? std::fopen(argv[2], "w") : stdout;
+	if (out == nullptr)
+	{
+		std::cerr << "can't write " << argv[2] << "\n";
+		return 1;
+	}
+
+	std::fprintf(out, "# sampleRate %g, maxPlanets %d, maxBlockSize %d\n", sampleRate, maxPlanets, maxBlockSize);
+	std::fprintf(out, "samplePos,timeSecs,numDropped,numActiveTaps");
+	for (auto p = 0; p < maxPlanets; ++p)
+		std::fprintf(out, ",phase%d", p);
+	for (auto p = 0; p < maxPlanets; ++p)
+		std::fprintf(out, ",mag%d", p);
+	std::fprintf(out, "\n");
+
+	std::vector<float> phase, mag;
+	int64_t samplePos;
+	double timeSecs;
+	int32_t numDropped, numPlanets, numSamples, numActiveTaps = -1;
+	auto numBlocks = 0;
+	while (read(file, samplePos) && read(file, timeSecs) && read(file, numDropped)
+		&& read(file, numPlanets) && read(file, numSamples)
+		&& (version < 2 || read(file, numActiveTaps)))
+	{
+		if (numPlanets < 0 || numPlanets > maxPlanets || numSamples < 0 || numSamples > maxBlockSize)
+		{
+			std::cerr << "corrupt record after block " << numBlocks << "\n";
+			break;
+		}
+		const auto size = static_cast<size_t>(numPlanets * numSamples);
+		if (!read(file, phase, size) || !read(file, mag, size))
+		{
+			std::cerr << "truncated record after block " << numBlocks << "\n";
+			break;
+		}
+
+		for (auto s = 0; s < numSamples; ++s)
+		{
+			std::fprintf(out, "%lld,%.6f,%d,", static_cast<long long>(samplePos + s), timeSecs, numDropped);
+			if (numActiveTaps >= 0)
+				std::fprintf(out, "%d", numActiveTaps);
+			for (auto p = 0; p < maxPlanets; ++p)
+				if (p < numPlanets)
+					std::fprintf(out, ",%g", phase[p * numSamples + s]);
+				else
+					std::fprintf(out, ",");
+			for (auto p = 0; p < maxPlanets; ++p)
+				if (p < numPlanets)
+					std::fprintf(out, ",%g", mag[p * numSamples + s]);
+				else
+					std::fprintf(out, ",");
+			std::fprintf(out, "\n");
+		}
+		++numBlocks;
+	}
+
+	if (out != stdout)
+		std::fclose(out);
+	std::cerr << numBlocks << " blocks\n";
+	return 0;
+}